@@ -8,33 +8,8 @@
 #include <pthread.h>
 #include <netinet/tcp.h>
 
-#define PORT 58501
-#define WINDOW_WIDTH 1200
-#define WINDOW_HEIGHT 700
-#define MAX_CLIENTS 5
-#define MAX_SNAKE_LENGTH 100
-#define SNAKE_SEGMENT_DIMENSION 15
-
-#define MIN_X 0
-#define MAX_X (WINDOW_WIDTH - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
-#define MIN_Y 0
-#define MAX_Y (WINDOW_HEIGHT - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
-
-typedef struct {
-    int x;
-    int y;
-} SnakeSegment;
-
-typedef struct {
-    SnakeSegment head;
-    SnakeSegment body[MAX_SNAKE_LENGTH - 1]; // -1 for excluding head
-    int body_length;
-    int isAlive;
-} Snake;
-
-typedef struct{
-    int deltaX, deltaY;
-} Movement;
+#include "protocol.h"
+#include "trace.h"
 
 // Global Variables
 Snake otherPlayers[MAX_CLIENTS];
@@ -43,6 +18,35 @@ int clientSocket;
 int startSignal = 0;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 int win = 0;
+int killedByServer = 0;
+
+// Network Timing - Guarded by mutex
+#define CLOCK_SAMPLES 8
+int64_t clockOffset = 0; // Server clock minus local clock, in microseconds
+int clockSynchronized = 0;
+uint32_t smoothedRTT = 0;
+uint32_t rttJitter = 0;
+uint32_t sampleRTT[CLOCK_SAMPLES];
+int64_t sampleOffset[CLOCK_SAMPLES];
+int sampleCount = 0;
+uint64_t lastPingTime = 0;
+
+// World Hash - Guarded by mutex
+#define KEYFRAME_RETRY_MICROS 1000000
+uint64_t otherHashes[MAX_CLIENTS]; // hashSnake() of each entry in otherPlayers
+int keyframeWanted = 0; // Set by the receive thread, sent by the main loop so only it writes to the socket
+int keyframePending = 0;
+uint64_t keyframeRequestTime = 0;
+
+// Food - Guarded by mutex
+int foodCells[FOOD_COUNT];
+int foodCount = 0;
+int growthOwed = 0; // Segments the server granted for food, spent by moveSnake()
+
+// Frame Tracing - Main thread only
+uint64_t inputTime = 0; // First direction change that is not on screen yet
+int inputMoved = 0; // moveSnake() has applied it, the next present shows it
+int traceExports = 0;
 
 // SDL Variables
 SDL_Renderer* renderer;
@@ -55,6 +59,9 @@ SDL_Surface* waitingTextSurface = NULL;
 SDL_Texture* waitingTextTexture = NULL;
 SDL_Surface* winTextSurface = NULL;
 SDL_Texture* winTextTexture = NULL;
+SDL_Surface* pingTextSurface = NULL;
+SDL_Texture* pingTextTexture = NULL;
+int pingTextValue = -1;
 
 // Function Prototypes
 void *receiveThread(void *arg); // For receiving Broadcasted Snake Positions
@@ -62,25 +69,40 @@ void moveSnake(Snake *snake, Movement movement);
 void handlePlayerInput(SDL_Event *event, Movement *playerDirection, int *quit, Movement *lastValidDirection, Snake *playerSnake);
 void checkState(Snake* playerSnake, Snake* otherPlayers, int numOtherPlayers);
 void initPlayerSnake(Snake *playerSnake, Movement *playerDirection);
-void initConnection();
+void initConnection(const char *serverHost, int serverPort);
+void sendSnakeUpdate(Snake *playerSnake);
+void sendPing();
+void handlePong(const uint8_t *pong);
+void checkWorldHash(uint32_t tick, uint64_t expected);
+int receiveKeyframe(int clientSocket);
+int receiveFood(int clientSocket);
+void sendKeyframeRequest();
+void exportTrace();
 
 // SDL Function Prototypes
 int initSDL();
 void initSDL_ttf();
 void renderAssets(SDL_Renderer* renderer, Snake* playerSnake, Snake* otherPlayers, int numOtherPlayers);
+void presentFrame(SDL_Renderer* renderer);
 void *receiveThread(void *arg);
 void showDeathMessage();
 void showWaitingMessage();
 void showWinMessage();
+void showPingMessage();
 
-int main(){
+int main(int argc, char *argv[]){
+    // Optional server address: ./Snake-Game [host] [port]
+    const char *serverHost = argc > 1 ? argv[1] : "172.29.5.228";
+    int serverPort = argc > 2 ? atoi(argv[2]) : PORT;
     int numOtherPlayers = MAX_CLIENTS - 1;
     int quit = 0;
     Movement playerDirection;
     Snake playerSnake;
     SDL_Event event;
 
-    initConnection();
+    traceInit();
+    traceThreadName("main");
+    initConnection(serverHost, serverPort);
     initSDL();
     initSDL_ttf();
 
@@ -102,33 +124,44 @@ int main(){
         
         renderAssets(renderer, &playerSnake, otherPlayers, numOtherPlayers);
 
-        send(clientSocket, &playerID,sizeof(int), 0);
-        send(clientSocket, &playerSnake, sizeof(Snake), 0);
+        sendPing();
+        sendKeyframeRequest();
+        sendSnakeUpdate(&playerSnake);
 
         renderAssets(renderer, &playerSnake, otherPlayers, numOtherPlayers);
+        SDL_Delay(50); // One update per server tick
     }
     
     // Game Loop for SDL Events
     while(!quit){
+        uint64_t frameStart = traceBegin();
         Movement lastValidDirection = playerDirection;
+        uint64_t traceStart = traceBegin();
         handlePlayerInput(&event, &playerDirection, &quit, &lastValidDirection, &playerSnake);
+        traceEnd("handlePlayerInput", traceStart, 0);
+        if(killedByServer) playerSnake.isAlive = 0;
         renderAssets(renderer, &playerSnake, otherPlayers, numOtherPlayers);
 
         if(playerSnake.isAlive){
+            traceStart = traceBegin();
             moveSnake(&playerSnake, playerDirection);
-            
+            traceEnd("moveSnake", traceStart, 0);
+            if(inputTime != 0) inputMoved = 1;
         }
 
-        send(clientSocket, &playerID, sizeof(int), 0);
-        send(clientSocket, &playerSnake, sizeof(Snake), 0);
+        sendPing();
+        sendKeyframeRequest();
+        sendSnakeUpdate(&playerSnake);
 
         renderAssets(renderer, &playerSnake, otherPlayers, numOtherPlayers);
         
-        SDL_RenderPresent(renderer);
+        presentFrame(renderer);
         SDL_Delay(50);
         checkState(&playerSnake, otherPlayers, numOtherPlayers);
+        traceEnd("frame", frameStart, 0);
     }
 
+    if(traceEnabled) exportTrace();
     close(clientSocket);
 
     return 0;
@@ -226,10 +259,20 @@ void initSDL_ttf(){
 }
 
 void renderAssets(SDL_Renderer* renderer, Snake* playerSnake, Snake* otherPlayers, int numOtherPlayers) {
-    
+    uint64_t traceStart = traceBegin();
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255); // Set background color
     SDL_RenderClear(renderer); // Clear the screen
 
+    // Render the food
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    pthread_mutex_lock(&mutex);
+    for(int f = 0; f < foodCount; ++f) {
+        SnakeSegment food = cellSegment(foodCells[f]);
+        SDL_Rect foodRect = { food.x, food.y, SNAKE_SEGMENT_DIMENSION, SNAKE_SEGMENT_DIMENSION };
+        SDL_RenderFillRect(renderer, &foodRect);
+    }
+    pthread_mutex_unlock(&mutex);
+
     // Render the player's snake
     if(playerSnake->isAlive) {
         SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
@@ -265,23 +308,112 @@ void renderAssets(SDL_Renderer* renderer, Snake* playerSnake, Snake* otherPlayer
     if(win){
         showWinMessage();
     }
+    showPingMessage();
+    traceEnd("renderAssets", traceStart, 0);
 
     // Update the window
+    presentFrame(renderer);
+}
+
+void presentFrame(SDL_Renderer* renderer) {
+    uint64_t traceStart = traceBegin();
     SDL_RenderPresent(renderer);
+    traceEnd("SDL_RenderPresent", traceStart, 0);
+
+    // Input-to-photon: key press until the first present that shows the move
+    if(inputMoved) {
+        traceCounter("input to photon (us)", monotonicMicros() - inputTime);
+        inputTime = 0;
+        inputMoved = 0;
+    }
 }
 
 void *receiveThread(void *arg) {
     int clientSocket = *((int *) arg);
+    traceThreadName("receive");
     while (1) {
         int receivedPlayerID;
+        uint8_t type;
+        uint8_t tick[4];
         Snake receivedSnake;
 
-        recv(clientSocket, &startSignal, sizeof(int), 0);
-        recv(clientSocket, &receivedPlayerID, sizeof(int), 0);
-        recv(clientSocket, &receivedSnake, sizeof(Snake), 0);
+        if(recvAll(clientSocket, &type, 1) == -1) {
+            printf("Lost connection to server.\n");
+            break;
+        }
+        // Timed from the first byte, waiting for a message to arrive is not part of the recv
+        uint64_t traceStart = traceBegin();
+        if(type == MSG_PONG) {
+            uint8_t pong[PONG_MESSAGE_SIZE - 1];
+            if(recvAll(clientSocket, pong, sizeof(pong)) == -1) {
+                printf("Lost connection to server.\n");
+                break;
+            }
+            handlePong(pong);
+            traceEnd("recv pong", traceStart, 0);
+            continue;
+        }
+        if(type == MSG_HASH) {
+            uint8_t hash[HASH_MESSAGE_SIZE - 1];
+            if(recvAll(clientSocket, hash, sizeof(hash)) == -1) {
+                printf("Lost connection to server.\n");
+                break;
+            }
+            checkWorldHash(getU32(hash), getU64(hash + 4));
+            traceEnd("recv hash", traceStart, getU32(hash));
+            continue;
+        }
+        if(type == MSG_FOOD) {
+            if(receiveFood(clientSocket) == -1) {
+                printf("Lost connection to server.\n");
+                break;
+            }
+            traceEnd("recv food", traceStart, 0);
+            continue;
+        }
+        if(type == MSG_GROW) {
+            uint8_t grow[GROW_MESSAGE_SIZE - 1];
+            if(recvAll(clientSocket, grow, sizeof(grow)) == -1) {
+                printf("Lost connection to server.\n");
+                break;
+            }
+            pthread_mutex_lock(&mutex);
+            growthOwed += grow[4];
+            pthread_mutex_unlock(&mutex);
+            traceEnd("recv grow", traceStart, grow[4]);
+            continue;
+        }
+        if(type == MSG_KEYFRAME) {
+            if(receiveKeyframe(clientSocket) == -1) {
+                printf("Lost connection to server.\n");
+                break;
+            }
+            traceEnd("recv keyframe", traceStart, 0);
+            continue;
+        }
+        if(type != MSG_SNAKE ||
+            recvAll(clientSocket, &startSignal, sizeof(int)) == -1 ||
+            recvAll(clientSocket, &receivedPlayerID, sizeof(int)) == -1 ||
+            recvAll(clientSocket, tick, sizeof(tick)) == -1 ||
+            recvSnake(clientSocket, &receivedSnake) == -1) {
+            printf("Lost connection to server.\n");
+            break;
+        }
+        traceEnd("recv snake", traceStart, getU32(tick));
+        if(receivedPlayerID < 1 || receivedPlayerID > MAX_CLIENTS) continue;
 
-        if(receivedPlayerID != playerID){
+        if(receivedPlayerID != playerID && receivedSnake.head.x == -1 && receivedSnake.head.y == -1) {
+            // Player disconnect handling
             pthread_mutex_lock(&mutex);
+            otherPlayers[receivedPlayerID - 1].head.x = -1;
+            otherPlayers[receivedPlayerID - 1].head.y = -1;
+            otherPlayers[receivedPlayerID - 1].body_length = 0;
+            otherPlayers[receivedPlayerID - 1].isAlive = 0;
+            otherHashes[receivedPlayerID - 1] = 0;
+            pthread_mutex_unlock(&mutex);
+        } else if(receivedPlayerID != playerID){
+            pthread_mutex_lock(&mutex);
+            Snake previousSnake = otherPlayers[receivedPlayerID - 1];
             otherPlayers[receivedPlayerID - 1].head = receivedSnake.head;
             otherPlayers[receivedPlayerID - 1].body_length = receivedSnake.body_length;
             otherPlayers[receivedPlayerID - 1].isAlive = receivedSnake.isAlive;
@@ -295,18 +427,26 @@ void *receiveThread(void *arg) {
                     otherPlayers[receivedPlayerID - 1].body[i].y = receivedSnake.body[i].y;
                 }
             }
+            otherHashes[receivedPlayerID - 1] = rehashSnake(otherHashes[receivedPlayerID - 1], receivedPlayerID,
+                &previousSnake, &otherPlayers[receivedPlayerID - 1]);
             pthread_mutex_unlock(&mutex);
-        } else if(receivedSnake.head.x == -1 && receivedSnake.head.y == -1) {
-            // Player disconnect handling
-            otherPlayers[receivedPlayerID - 1].head.x = -1;
-            otherPlayers[receivedPlayerID - 1].head.y = -1;
-            otherPlayers[receivedPlayerID - 1].body_length = 0;
+        } else if(!receivedSnake.isAlive) {
+            // The server's collision check has the final say over our own
+            killedByServer = 1;
         }
     }
     return NULL;
 }
 
 void moveSnake(Snake *snake, Movement movement) {
+    // Grow by keeping the tail where it is
+    pthread_mutex_lock(&mutex);
+    if(growthOwed > 0 && snake->body_length < MAX_SNAKE_LENGTH - 1) {
+        snake->body_length++;
+        growthOwed--;
+    }
+    pthread_mutex_unlock(&mutex);
+
     // Move the body segments
     for(int i = snake->body_length - 1; i > 0; --i) {
         snake->body[i] = snake->body[i - 1]; // Move each body segment to the position of the segment before it
@@ -365,7 +505,10 @@ void handlePlayerInput(SDL_Event *event, Movement *playerDirection, int *quit, M
         if(event->type == SDL_QUIT) {
             playerSnake->isAlive = 0;
             *quit = 1;
+        } else if(event->type == SDL_KEYDOWN && event->key.keysym.sym == SDLK_F12) {
+            if(traceEnabled) exportTrace();
         } else if(event->type == SDL_KEYDOWN) {
+            traceInstant("key", event->key.keysym.sym);
             Movement newDirection = *playerDirection;
             switch (event->key.keysym.sym) {
                 case SDLK_UP:
@@ -391,18 +534,181 @@ void handlePlayerInput(SDL_Event *event, Movement *playerDirection, int *quit, M
                 // Update the player direction and last valid direction
                 *playerDirection = newDirection;
                 *lastValidDirection = *playerDirection;
+                if(traceEnabled && inputTime == 0) inputTime = monotonicMicros();
             }
         }
     }
 }
 
 void initPlayerSnake(Snake *playerSnake, Movement *playerDirection){
-    recv(clientSocket, &playerID, sizeof(int), 0);
-    recv(clientSocket, playerSnake, sizeof(Snake), 0);
-    recv(clientSocket, playerDirection, sizeof(Movement), 0);
+    if(recvAll(clientSocket, &playerID, sizeof(int)) == -1 ||
+        recvSnake(clientSocket, playerSnake) == -1 ||
+        recvAll(clientSocket, playerDirection, sizeof(Movement)) == -1) {
+        perror("Error joining the server");
+        close(clientSocket);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Stamps the update with the first server tick that starts after its expected arrival
+// (now + one-way delay + jitter margin, on the server clock)
+void sendSnakeUpdate(Snake *playerSnake){
+    uint8_t message[SNAKE_MESSAGE_MAX_SIZE];
+    uint32_t targetTick = 0;
+    uint64_t sendTime = 0;
+
+    pthread_mutex_lock(&mutex);
+    if(clockSynchronized) {
+        sendTime = monotonicMicros() + clockOffset;
+        targetTick = (sendTime + smoothedRTT / 2 + rttJitter) / TICK_MICROS + 1;
+    }
+    pthread_mutex_unlock(&mutex);
+
+    message[0] = MSG_SNAKE;
+    memcpy(message + 1, &playerID, sizeof(int));
+    putU32(message + 1 + sizeof(int), targetTick);
+    putU64(message + 5 + sizeof(int), sendTime);
+    int size = 13 + sizeof(int);
+    size += packSnake(playerSnake, message + size);
+
+    uint64_t traceStart = traceBegin();
+    sendAll(clientSocket, message, size);
+    traceEnd("send snake", traceStart, targetTick);
 }
 
-void initConnection(){
+void sendPing(){
+    uint64_t now = monotonicMicros();
+    if(now - lastPingTime < PING_INTERVAL_MICROS) return;
+    lastPingTime = now;
+
+    uint8_t ping[PING_MESSAGE_SIZE];
+    ping[0] = MSG_PING;
+    putU64(ping + 1, now);
+    pthread_mutex_lock(&mutex);
+    putU32(ping + 9, smoothedRTT);
+    putU32(ping + 13, rttJitter);
+    pthread_mutex_unlock(&mutex);
+
+    uint64_t traceStart = traceBegin();
+    sendAll(clientSocket, ping, sizeof(ping));
+    traceEnd("send ping", traceStart, 0);
+}
+
+// Our copy of the other snakes must add up to the server's hash after the same tick
+void checkWorldHash(uint32_t tick, uint64_t expected){
+    uint64_t hash = 0;
+    uint64_t now = monotonicMicros();
+
+    pthread_mutex_lock(&mutex);
+    for(int i = 0; i < MAX_CLIENTS; ++i) {
+        if(i != playerID - 1) hash ^= otherHashes[i];
+    }
+    if(hash != expected && (!keyframePending || now - keyframeRequestTime > KEYFRAME_RETRY_MICROS)) {
+        printf("World out of sync at tick %u, requesting a keyframe.\n", tick);
+        keyframeWanted = 1;
+        keyframePending = 1;
+        keyframeRequestTime = now;
+    }
+    pthread_mutex_unlock(&mutex);
+}
+
+// Replaces every other snake, a player missing from the keyframe has left
+int receiveKeyframe(int clientSocket){
+    uint8_t header[KEYFRAME_HEADER_SIZE - 1];
+    Snake snakes[MAX_CLIENTS];
+    int listed[MAX_CLIENTS] = {0};
+
+    if(recvAll(clientSocket, header, sizeof(header)) == -1) return -1;
+    for(int i = 0; i < header[4]; ++i) {
+        uint8_t id;
+        Snake snake;
+        if(recvAll(clientSocket, &id, 1) == -1 || recvSnake(clientSocket, &snake) == -1) return -1;
+        if(id < 1 || id > MAX_CLIENTS) continue;
+        snakes[id - 1] = snake;
+        listed[id - 1] = 1;
+    }
+
+    pthread_mutex_lock(&mutex);
+    for(int i = 0; i < MAX_CLIENTS; ++i) {
+        if(i == playerID - 1) continue;
+        if(listed[i]) {
+            otherPlayers[i] = snakes[i];
+        } else {
+            otherPlayers[i].head.x = -1;
+            otherPlayers[i].head.y = -1;
+            otherPlayers[i].body_length = 0;
+            otherPlayers[i].isAlive = 0;
+        }
+        otherHashes[i] = hashSnake(i + 1, &otherPlayers[i]);
+    }
+    keyframePending = 0;
+    pthread_mutex_unlock(&mutex);
+    return 0;
+}
+
+int receiveFood(int clientSocket){
+    uint8_t header[FOOD_HEADER_SIZE - 1];
+    uint8_t cells[FOOD_COUNT * 2];
+
+    if(recvAll(clientSocket, header, sizeof(header)) == -1) return -1;
+    int count = header[4];
+    if(count > FOOD_COUNT || recvAll(clientSocket, cells, count * 2) == -1) return -1;
+
+    pthread_mutex_lock(&mutex);
+    foodCount = count;
+    for(int f = 0; f < count; ++f) foodCells[f] = getU16(cells + 2 * f);
+    pthread_mutex_unlock(&mutex);
+    return 0;
+}
+
+void sendKeyframeRequest(){
+    pthread_mutex_lock(&mutex);
+    int wanted = keyframeWanted;
+    keyframeWanted = 0;
+    pthread_mutex_unlock(&mutex);
+    if(!wanted) return;
+
+    uint8_t type = MSG_KEYFRAME_REQUEST;
+    sendAll(clientSocket, &type, 1);
+}
+
+// NTP-style estimate: t0/t3 are local send/receive times, t1/t2 the server's receive/send times
+void handlePong(const uint8_t *pong){
+    int64_t t3 = monotonicMicros();
+    int64_t t0 = getU64(pong);
+    int64_t t1 = getU64(pong + 8);
+    int64_t t2 = getU64(pong + 16);
+    int64_t rtt = (t3 - t0) - (t2 - t1);
+    if(rtt < 0) rtt = 0;
+    int64_t offset = ((t1 - t0) + (t2 - t3)) / 2;
+
+    pthread_mutex_lock(&mutex);
+    // RFC 6298 style smoothing for the displayed RTT and its mean deviation
+    if(sampleCount == 0) {
+        smoothedRTT = rtt;
+        rttJitter = rtt / 2;
+    } else {
+        int64_t deviation = (int64_t)smoothedRTT - rtt;
+        if(deviation < 0) deviation = -deviation;
+        rttJitter = (3 * (int64_t)rttJitter + deviation) / 4;
+        smoothedRTT = (7 * (int64_t)smoothedRTT + rtt) / 8;
+    }
+
+    // The sample with the lowest RTT has the least queueing asymmetry, so its offset is trusted most
+    sampleRTT[sampleCount % CLOCK_SAMPLES] = rtt;
+    sampleOffset[sampleCount % CLOCK_SAMPLES] = offset;
+    sampleCount++;
+    int samples = sampleCount < CLOCK_SAMPLES ? sampleCount : CLOCK_SAMPLES;
+    int best = 0;
+    for(int i = 1; i < samples; ++i) {
+        if(sampleRTT[i] < sampleRTT[best]) best = i;
+    }
+    clockOffset = sampleOffset[best];
+    clockSynchronized = 1;
+    pthread_mutex_unlock(&mutex);
+}
+
+void initConnection(const char *serverHost, int serverPort){
     // Create a client socket
     clientSocket = socket(AF_INET, SOCK_STREAM, 0);
     if(clientSocket == -1) {
@@ -421,8 +727,12 @@ void initConnection(){
     // Set up the server address struct
     struct sockaddr_in serverAddress;
     serverAddress.sin_family = AF_INET;
-    serverAddress.sin_port = htons(PORT);
-    inet_pton(AF_INET, "172.29.5.228", &serverAddress.sin_addr);
+    serverAddress.sin_port = htons(serverPort);
+    if(inet_pton(AF_INET, serverHost, &serverAddress.sin_addr) != 1) {
+        fprintf(stderr, "Invalid server address: %s\n", serverHost);
+        close(clientSocket);
+        exit(EXIT_FAILURE);
+    }
 
     // Connect to the server
     if(connect(clientSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) == -1) {
@@ -474,6 +784,38 @@ void showWinMessage() {
     }
 }
 
+void showPingMessage() {
+    if(font == NULL) return;
+
+    pthread_mutex_lock(&mutex);
+    int ping = clockSynchronized ? (int)((smoothedRTT + 500) / 1000) : -1;
+    pthread_mutex_unlock(&mutex);
+    if(ping < 0) return;
+
+    // Only re-render the text when the value changes
+    if(ping != pingTextValue) {
+        if(pingTextTexture != NULL) SDL_DestroyTexture(pingTextTexture);
+        if(pingTextSurface != NULL) SDL_FreeSurface(pingTextSurface);
+
+        char pingText[32];
+        snprintf(pingText, sizeof(pingText), "Ping: %d ms", ping);
+        SDL_Color pingTextColor = { 255, 255, 255 };
+        pingTextSurface = TTF_RenderText_Solid(font, pingText, pingTextColor);
+        pingTextTexture = pingTextSurface != NULL ? SDL_CreateTextureFromSurface(renderer, pingTextSurface) : NULL;
+        pingTextValue = ping;
+    }
+
+    if(pingTextTexture != NULL) {
+        int textWidth = pingTextSurface->w;
+        int textHeight = pingTextSurface->h;
+
+        // Adjust coordinates to place the text at the top right corner
+        SDL_Rect textRect = { WINDOW_WIDTH - textWidth - 10, 10, textWidth, textHeight };
+
+        SDL_RenderCopy(renderer, pingTextTexture, NULL, &textRect);
+    }
+}
+
 void checkState(Snake* playerSnake, Snake* otherPlayers, int numOtherPlayers){
     if(startSignal == 0) return;
     if(win == 1) return;
@@ -493,4 +835,14 @@ void checkState(Snake* playerSnake, Snake* otherPlayers, int numOtherPlayers){
     if(aliveOtherPlayers == 0) {
         win = 1;
     }
-}
\ No newline at end of file
+}
+
+void exportTrace(){
+    char path[64];
+    snprintf(path, sizeof(path), "snake-trace-%d-%d.json", (int)getpid(), ++traceExports);
+    if(traceExport(path) == -1) {
+        perror("Error writing trace");
+        return;
+    }
+    printf("Trace written to %s\n", path);
+}
@@ -0,0 +1,283 @@
+// Local agent: follows a server's world frames through shared memory instead of a socket.
+// As a spectator it only reads frames and reports how far behind the server it ran, as a bot
+// it also claims a player slot and steers that snake by writing to the server's input ring.
+//
+// Usage: ./local-agent [-m shared-memory-name] [-b] [-t seconds]
+//   The server must be started with the same name: ./server -m /snake-game
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "protocol.h"
+#include "shmtransport.h"
+
+#define MAX_LATENCY_SAMPLES 100000
+#define IDLE_SLEEP_MICROS 500 // Between polls when the server has not published a new frame
+
+typedef struct {
+    long long frames;
+    long long tornFrames; // Overwritten while being read
+    long long hashMismatches; // Decoded snakes do not add up to the server's world hash
+    long long moves;
+    long long rejectedMoves; // Input ring was full
+    int length; // Bot's snake, head included, in the last frame
+    uint64_t latencies[MAX_LATENCY_SAMPLES]; // Server publish -> read, in microseconds
+    long long latencyCount;
+} AgentStats;
+
+typedef struct {
+    uint32_t tick;
+    uint64_t publishTime;
+    uint64_t worldHash;
+    int startSignal;
+    int count;
+    int playerIDs[MAX_CLIENTS];
+    int growth[MAX_CLIENTS];
+    Snake snakes[MAX_CLIENTS];
+    int foodCount;
+    int foodCells[FOOD_COUNT];
+} WorldFrame;
+
+SharedTransport transport;
+uint32_t slotClaim; // Our claim on the bot's player slot, the slot may be handed to another agent once we lose it
+AgentStats stats;
+volatile sig_atomic_t stopRequested = 0;
+
+int parseWorldFrame(const uint8_t *data, uint32_t size, WorldFrame *frame);
+void steerBot(int playerID, WorldFrame *frame);
+void printReport(FrameReader *reader, int playerID);
+void handleSignal(int signal);
+
+int main(int argc, char *argv[]) {
+    const char *name = SHM_DEFAULT_NAME;
+    int bot = 0;
+    int duration = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "m:bt:")) != -1) {
+        switch (option) {
+            case 'm': name = optarg; break;
+            case 'b': bot = 1; break;
+            case 't': duration = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-m shared-memory-name] [-b] [-t seconds]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (shmAttach(&transport, name) == -1) {
+        perror("Error attaching to the server's shared memory");
+        exit(EXIT_FAILURE);
+    }
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+
+    int playerID = -1;
+    if (bot) {
+        playerID = shmClaimSlot(&transport, SLOT_LOCAL_PENDING, &slotClaim);
+        if (playerID == -1) {
+            fprintf(stderr, "Connection Denied: Max number of players reached\n");
+            shmDetach(&transport);
+            exit(EXIT_FAILURE);
+        }
+        printf("Joined as player %d\n", playerID);
+        fflush(stdout);
+    }
+
+    FrameReader reader;
+    shmInitReader(&reader, &transport);
+    uint64_t serverStart = shmServerStart(&transport);
+    uint64_t start = monotonicMicros();
+
+    while (!stopRequested) {
+        if (duration > 0 && monotonicMicros() - start >= (uint64_t)duration * 1000000) break;
+
+        uint32_t size;
+        const uint8_t *data = shmBeginRead(&reader, &size);
+        if (data == NULL) {
+            usleep(IDLE_SLEEP_MICROS);
+            continue;
+        }
+
+        // Decoded straight out of the shared slot, then checked for a concurrent overwrite
+        WorldFrame frame;
+        int parsed = parseWorldFrame(data, size, &frame);
+        if (!shmEndRead(&reader)) {
+            stats.tornFrames++;
+            continue;
+        }
+        if (parsed == -1) continue;
+
+        stats.frames++;
+        if (bot) {
+            // Taken out of the match after going quiet for too long, its moves would be ignored
+            int state = shmSlotState(&transport, playerID);
+            if (shmSlotClaim(&transport, playerID) != slotClaim || (state != SLOT_LOCAL_PENDING && state != SLOT_LOCAL_ACTIVE)) {
+                fprintf(stderr, "Timed out by the server\n");
+                break;
+            }
+            shmHeartbeat(&transport, playerID, frame.tick);
+        }
+        uint64_t hash = 0;
+        for (int i = 0; i < frame.count; ++i) hash ^= hashSnake(frame.playerIDs[i], &frame.snakes[i]);
+        if (hash != frame.worldHash) stats.hashMismatches++;
+
+        uint64_t now = monotonicMicros() - serverStart;
+        if (stats.latencyCount < MAX_LATENCY_SAMPLES && now >= frame.publishTime) {
+            stats.latencies[stats.latencyCount++] = now - frame.publishTime;
+        }
+
+        if (bot) steerBot(playerID, &frame);
+    }
+
+    // A slot we already lost may belong to another agent by now, so only leave it under our own claim
+    if (bot && shmChangeSlotState(&transport, playerID, slotClaim, SLOT_LOCAL_ACTIVE, SLOT_LOCAL_LEFT) == -1) {
+        shmChangeSlotState(&transport, playerID, slotClaim, SLOT_LOCAL_PENDING, SLOT_LOCAL_LEFT);
+    }
+    printReport(&reader, playerID);
+    shmDetach(&transport);
+    return 0;
+}
+
+int parseWorldFrame(const uint8_t *data, uint32_t size, WorldFrame *frame) {
+    if (size < WORLD_FRAME_HEADER_SIZE) return -1;
+
+    frame->tick = getU32(data);
+    frame->publishTime = getU64(data + 4);
+    frame->worldHash = getU64(data + 12);
+    frame->startSignal = data[20];
+    frame->count = data[21];
+    if (frame->count > MAX_CLIENTS) return -1;
+
+    uint32_t offset = WORLD_FRAME_HEADER_SIZE;
+    for (int i = 0; i < frame->count; ++i) {
+        if (offset >= size) return -1;
+        if (offset + 2 > size) return -1;
+        frame->playerIDs[i] = data[offset++];
+        frame->growth[i] = data[offset++];
+        int used = unpackSnake(data + offset, size - offset, &frame->snakes[i]);
+        if (used == -1) return -1;
+        offset += used;
+    }
+
+    if (offset >= size) return -1;
+    frame->foodCount = data[offset++];
+    if (frame->foodCount > FOOD_COUNT || offset + frame->foodCount * 2 > size) return -1;
+    for (int f = 0; f < frame->foodCount; ++f) frame->foodCells[f] = getU16(data + offset + 2 * f);
+    return 0;
+}
+
+static int blocked(const uint8_t *occupied, SnakeSegment segment) {
+    int cell = cellIndex(segment);
+    return cell < 0 || occupied[cell];
+}
+
+static int foodDistance(WorldFrame *frame, SnakeSegment segment) {
+    int best = WINDOW_WIDTH + WINDOW_HEIGHT;
+    for (int f = 0; f < frame->foodCount; ++f) {
+        SnakeSegment food = cellSegment(frame->foodCells[f]);
+        int distance = abs(food.x - segment.x) + abs(food.y - segment.y);
+        if (distance < best) best = distance;
+    }
+    return best;
+}
+
+// Heads for the nearest food, never into a wall or a snake when another way is open
+void steerBot(int playerID, WorldFrame *frame) {
+    Snake *snake = NULL;
+    int growth = 0;
+    uint8_t occupied[GRID_CELLS] = {0};
+
+    for (int i = 0; i < frame->count; ++i) {
+        Snake *other = &frame->snakes[i];
+        if (frame->playerIDs[i] == playerID) {
+            snake = other;
+            growth = frame->growth[i];
+        }
+        if (!other->isAlive) continue;
+
+        int cell = cellIndex(other->head);
+        if (cell >= 0) occupied[cell] = 1;
+        for (int j = 0; j < other->body_length; ++j) {
+            cell = cellIndex(other->body[j]);
+            if (cell >= 0) occupied[cell] = 1;
+        }
+    }
+    if (snake != NULL) stats.length = snake->body_length + 1;
+    if (snake == NULL || !snake->isAlive || !frame->startSignal || snake->body_length < 1) return;
+
+    int deltaX = snake->head.x - snake->body[0].x;
+    int deltaY = snake->head.y - snake->body[0].y;
+    int turns[3][2] = { { deltaX, deltaY }, { -deltaY, deltaX }, { deltaY, -deltaX } };
+
+    SnakeSegment next = { snake->head.x + deltaX, snake->head.y + deltaY };
+    int bestDistance = -1;
+    for (int i = 0; i < 3; ++i) {
+        SnakeSegment candidate = { snake->head.x + turns[i][0], snake->head.y + turns[i][1] };
+        if (blocked(occupied, candidate)) continue;
+
+        int distance = foodDistance(frame, candidate);
+        if (bestDistance == -1 || distance < bestDistance) {
+            next = candidate;
+            bestDistance = distance;
+        }
+    }
+
+    // Food eaten earlier is spent by keeping the tail in place
+    Snake moved = *snake;
+    if (growth > 0 && moved.body_length < MAX_SNAKE_LENGTH - 1) moved.body_length++;
+    for (int i = moved.body_length - 1; i > 0; --i) moved.body[i] = moved.body[i - 1];
+    moved.body[0] = moved.head;
+    moved.head = next;
+
+    // Same bytes as a client's MSG_SNAKE, targeting the tick after the one just shown
+    uint8_t message[SNAKE_MESSAGE_MAX_SIZE];
+    message[0] = MSG_SNAKE;
+    memcpy(message + 1, &playerID, sizeof(int));
+    putU32(message + 1 + sizeof(int), frame->tick + 1);
+    putU64(message + 5 + sizeof(int), monotonicMicros() - shmServerStart(&transport));
+    int size = 1 + sizeof(int) + 12;
+    size += packSnake(&moved, message + size);
+
+    if (shmSubmitInput(&transport, playerID, slotClaim, message, size) == 0) stats.moves++;
+    else stats.rejectedMoves++;
+}
+
+static int compareLatencies(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void printReport(FrameReader *reader, int playerID) {
+    char line[3][64];
+    int lines = 2;
+
+    snprintf(line[0], sizeof(line[0]), "frames %lld, skipped %llu, torn %lld, bad hash %lld",
+        stats.frames, (unsigned long long)reader->skippedFrames, stats.tornFrames, stats.hashMismatches);
+    if (stats.latencyCount > 0) {
+        qsort(stats.latencies, stats.latencyCount, sizeof(uint64_t), compareLatencies);
+        snprintf(line[1], sizeof(line[1]), "latency us p50 %llu, p99 %llu, max %llu",
+            (unsigned long long)stats.latencies[stats.latencyCount / 2],
+            (unsigned long long)stats.latencies[stats.latencyCount * 99 / 100],
+            (unsigned long long)stats.latencies[stats.latencyCount - 1]);
+    } else {
+        snprintf(line[1], sizeof(line[1]), "no frames read");
+    }
+    if (playerID != -1) {
+        snprintf(line[lines++], sizeof(line[2]), "player %d, length %d, moves %lld, rejected %lld",
+            playerID, stats.length, stats.moves, stats.rejectedMoves);
+    }
+
+    printf("+--------------------------------------------------+\n");
+    printf("| %-48s |\n", playerID == -1 ? "local spectator" : "local bot");
+    printf("+--------------------------------------------------+\n");
+    for (int i = 0; i < lines; ++i) printf("| %-48s |\n", line[i]);
+    printf("+--------------------------------------------------+\n");
+}
+
+void handleSignal(int signal) {
+    stopRequested = 1;
+}
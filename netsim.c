@@ -0,0 +1,591 @@
+// Network conditions simulator: a localhost TCP proxy between Snake-Game clients and the server
+// that adds latency, jitter, loss, reordering and bandwidth caps per direction.
+//
+// Usage: ./netsim [-P profile] [-u up] [-d down] [-l listenPort] [-p serverPort] [-o log.csv] [-t seconds] [-S seed]
+//        ./netsim -c [-S seed]
+//   up/down: latencyMs,jitterMs,lossPercent,reorderPercent,bandwidthKbps (0 kbps = unlimited)
+//   "up" is client -> server, "down" is server -> client.
+//   -c checks every profile against a fixed packet schedule without opening sockets, see runCheck().
+//
+// The game runs over TCP, so loss and reordering are shown the way the application would see them:
+// a lost segment arrives after a retransmission timeout, and a reordered segment is held back until
+// the missing bytes arrive, with every later byte waiting behind it (head-of-line blocking).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <netinet/tcp.h>
+
+#include "protocol.h"
+
+#define DEFAULT_LISTEN_PORT 58502
+#define CHUNK_SIZE 1400 // Each read of at most one MTU-sized payload is treated as a packet
+#define MIN_RETRANSMIT_MICROS 200000 // Linux minimum RTO
+#define MAX_DELAY_SAMPLES 65536
+
+// Check schedule: steady game-sized traffic, then one burst that has to queue behind the bandwidth cap
+#define CHECK_PACKETS 20000
+#define CHECK_PACKET_SIZE 200
+#define CHECK_INTERVAL_MICROS 10000
+#define CHECK_BURST_PACKETS 64 // Of CHUNK_SIZE bytes each, all arriving at once
+
+// Structs
+typedef struct {
+    int latencyMs;
+    int jitterMs;
+    double lossPercent;
+    double reorderPercent;
+    int bandwidthKbps;
+} LinkProfile;
+
+typedef struct {
+    const char *name;
+    LinkProfile link;
+} NamedProfile;
+
+typedef struct Chunk {
+    uint8_t data[CHUNK_SIZE];
+    int size;
+    int seq;
+    int lost;
+    int reordered;
+    uint64_t receiveTime;
+    uint64_t deliverTime;
+    struct Chunk *next;
+} Chunk;
+
+typedef struct {
+    const char *name;
+    long long chunks;
+    long long bytes;
+    long long lost;
+    long long reordered;
+    uint64_t firstReceive;
+    uint64_t lastSend;
+    uint64_t delays[MAX_DELAY_SAMPLES]; // Receive -> actual send, sampled per chunk
+    long long delayCount;
+    pthread_mutex_t lock;
+} DirectionStats;
+
+typedef struct {
+    int connectionID;
+    int from;
+    int to;
+    LinkProfile link;
+    DirectionStats *stats;
+    unsigned int seed;
+    Chunk *head;
+    Chunk *tail;
+    int closed;
+    uint64_t linkFree; // When the simulated link finishes serializing the last chunk
+    uint64_t lastDeliver; // TCP delivers in order, so no chunk may overtake the previous one
+    int nextSeq;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} Pipe;
+
+typedef struct {
+    int connectionID;
+    int clientSocket;
+    Pipe up;
+    Pipe down;
+} Connection;
+
+// Global Variables
+NamedProfile profiles[] = {
+    { "lan",    { 1,   0,  0.0, 0.0, 0 } },
+    { "wifi",   { 15,  10, 0.5, 0.5, 20000 } },
+    { "mobile", { 60,  25, 1.5, 1.0, 2000 } },
+    { "bad",    { 150, 60, 5.0, 3.0, 256 } },
+};
+LinkProfile upLink = { 0, 0, 0.0, 0.0, 0 };
+LinkProfile downLink = { 0, 0, 0.0, 0.0, 0 };
+DirectionStats upStats;
+DirectionStats downStats;
+int serverPort = PORT;
+FILE *logFile = NULL;
+pthread_mutex_t logMutex = PTHREAD_MUTEX_INITIALIZER;
+volatile sig_atomic_t stopRequested = 0;
+unsigned int randomSeed = 1;
+
+void parseArguments(int argc, char *argv[], int *listenPort, int *duration, int *check);
+int parseLink(const char *text, LinkProfile *link);
+void *connectionHandler(void *arg);
+void *pipeReader(void *arg);
+void *pipeWriter(void *arg);
+uint64_t scheduleChunk(Pipe *pipe, Chunk *chunk);
+void recordChunk(Pipe *pipe, Chunk *chunk, uint64_t sendTime);
+void printReport(DirectionStats *stats, LinkProfile *link);
+int runCheck(const char *name, LinkProfile link);
+void handleSignal(int signal);
+
+int main(int argc, char *argv[]) {
+    int listenPort = DEFAULT_LISTEN_PORT;
+    int duration = 0;
+    int check = 0;
+    parseArguments(argc, argv, &listenPort, &duration, &check);
+
+    if (check) {
+        int failures = 0;
+        for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i) {
+            failures += runCheck(profiles[i].name, profiles[i].link);
+        }
+        return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    upStats.name = "up (client -> server)";
+    downStats.name = "down (server -> client)";
+    pthread_mutex_init(&upStats.lock, NULL);
+    pthread_mutex_init(&downStats.lock, NULL);
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket == -1) {
+        perror("Error creating proxy socket");
+        exit(EXIT_FAILURE);
+    }
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+
+    // Only ever listen on loopback, this is a test tool
+    struct sockaddr_in proxyAddress;
+    memset(&proxyAddress, 0, sizeof(proxyAddress));
+    proxyAddress.sin_family = AF_INET;
+    proxyAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    proxyAddress.sin_port = htons(listenPort);
+
+    if (bind(listenSocket, (struct sockaddr*)&proxyAddress, sizeof(proxyAddress)) == -1) {
+        perror("Error binding proxy socket");
+        close(listenSocket);
+        exit(EXIT_FAILURE);
+    }
+    if (listen(listenSocket, MAX_CLIENTS) == -1) {
+        perror("Error listening for connections");
+        close(listenSocket);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("netsim: 127.0.0.1:%d -> 127.0.0.1:%d\n", listenPort, serverPort);
+    printf("  up:   %d ms +/- %d ms, %.1f%% loss, %.1f%% reorder, %d kbps\n",
+        upLink.latencyMs, upLink.jitterMs, upLink.lossPercent, upLink.reorderPercent, upLink.bandwidthKbps);
+    printf("  down: %d ms +/- %d ms, %.1f%% loss, %.1f%% reorder, %d kbps\n",
+        downLink.latencyMs, downLink.jitterMs, downLink.lossPercent, downLink.reorderPercent, downLink.bandwidthKbps);
+    fflush(stdout);
+
+    uint64_t start = monotonicMicros();
+    int connectionID = 0;
+    while (!stopRequested) {
+        if (duration > 0 && monotonicMicros() - start >= (uint64_t)duration * 1000000) break;
+
+        struct pollfd listenPoll = { listenSocket, POLLIN, 0 };
+        if (poll(&listenPoll, 1, 100) <= 0) continue;
+
+        int clientSocket = accept(listenSocket, NULL, NULL);
+        if (clientSocket == -1) continue;
+
+        Connection *connection = calloc(1, sizeof(Connection));
+        connection->connectionID = ++connectionID;
+        connection->clientSocket = clientSocket;
+
+        pthread_t connectionThread;
+        if (pthread_create(&connectionThread, NULL, connectionHandler, connection) != 0) {
+            perror("Error creating connection thread");
+            close(clientSocket);
+            free(connection);
+            continue;
+        }
+        pthread_detach(connectionThread);
+    }
+
+    close(listenSocket);
+    pthread_mutex_lock(&logMutex);
+    if (logFile != NULL) fclose(logFile);
+    logFile = NULL;
+    pthread_mutex_unlock(&logMutex);
+
+    printReport(&upStats, &upLink);
+    printReport(&downStats, &downLink);
+    return 0;
+}
+
+void parseArguments(int argc, char *argv[], int *listenPort, int *duration, int *check) {
+    int option;
+    while ((option = getopt(argc, argv, "P:u:d:l:p:o:t:S:c")) != -1) {
+        switch (option) {
+            case 'P': {
+                int found = 0;
+                for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i) {
+                    if (strcmp(optarg, profiles[i].name) == 0) {
+                        upLink = profiles[i].link;
+                        downLink = profiles[i].link;
+                        found = 1;
+                    }
+                }
+                if (!found) {
+                    fprintf(stderr, "Unknown profile %s (lan, wifi, mobile, bad)\n", optarg);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            }
+            case 'u':
+            case 'd':
+                if (parseLink(optarg, option == 'u' ? &upLink : &downLink) == -1) {
+                    fprintf(stderr, "Expected latencyMs,jitterMs,lossPercent,reorderPercent,bandwidthKbps\n");
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'l':
+                *listenPort = atoi(optarg);
+                break;
+            case 'p':
+                serverPort = atoi(optarg);
+                break;
+            case 'o':
+                logFile = fopen(optarg, "w");
+                if (logFile == NULL) {
+                    perror("Error opening log file");
+                    exit(EXIT_FAILURE);
+                }
+                fprintf(logFile, "connection,direction,seq,bytes,receive_us,scheduled_us,sent_us,delay_us,lost,reordered\n");
+                break;
+            case 't':
+                *duration = atoi(optarg);
+                break;
+            case 'S':
+                randomSeed = strtoul(optarg, NULL, 10);
+                break;
+            case 'c':
+                *check = 1;
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-P profile] [-u up] [-d down] [-l listenPort] [-p serverPort] [-o log.csv] [-t seconds] [-S seed]\n", argv[0]);
+                fprintf(stderr, "       %s -c [-S seed]\n", argv[0]);
+                exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int parseLink(const char *text, LinkProfile *link) {
+    LinkProfile parsed = { 0, 0, 0.0, 0.0, 0 };
+    int fields = sscanf(text, "%d,%d,%lf,%lf,%d", &parsed.latencyMs, &parsed.jitterMs,
+        &parsed.lossPercent, &parsed.reorderPercent, &parsed.bandwidthKbps);
+    if (fields < 1 || parsed.latencyMs < 0 || parsed.jitterMs < 0 || parsed.bandwidthKbps < 0) return -1;
+    *link = parsed;
+    return 0;
+}
+
+static void initPipe(Pipe *pipe, Connection *connection, int from, int to, LinkProfile link, DirectionStats *stats, unsigned int seed) {
+    pipe->connectionID = connection->connectionID;
+    pipe->from = from;
+    pipe->to = to;
+    pipe->link = link;
+    pipe->stats = stats;
+    pipe->seed = seed;
+    pthread_mutex_init(&pipe->lock, NULL);
+    pthread_cond_init(&pipe->ready, NULL);
+}
+
+void *connectionHandler(void *arg) {
+    Connection *connection = (Connection *)arg;
+
+    int serverSocket = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in serverAddress;
+    memset(&serverAddress, 0, sizeof(serverAddress));
+    serverAddress.sin_family = AF_INET;
+    serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    serverAddress.sin_port = htons(serverPort);
+
+    if (serverSocket == -1 || connect(serverSocket, (struct sockaddr*)&serverAddress, sizeof(serverAddress)) == -1) {
+        perror("Error connecting to server");
+        if (serverSocket != -1) close(serverSocket);
+        close(connection->clientSocket);
+        free(connection);
+        return NULL;
+    }
+
+    // The proxy itself must not add Nagle delays on top of the simulated ones
+    int flag = 1;
+    setsockopt(serverSocket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(int));
+    setsockopt(connection->clientSocket, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(int));
+
+    unsigned int seed = randomSeed * 7919 + connection->connectionID * 2;
+    initPipe(&connection->up, connection, connection->clientSocket, serverSocket, upLink, &upStats, seed);
+    initPipe(&connection->down, connection, serverSocket, connection->clientSocket, downLink, &downStats, seed + 1);
+
+    pthread_t threads[4];
+    pthread_create(&threads[0], NULL, pipeReader, &connection->up);
+    pthread_create(&threads[1], NULL, pipeWriter, &connection->up);
+    pthread_create(&threads[2], NULL, pipeReader, &connection->down);
+    pthread_create(&threads[3], NULL, pipeWriter, &connection->down);
+    for (int i = 0; i < 4; ++i) pthread_join(threads[i], NULL);
+
+    close(serverSocket);
+    close(connection->clientSocket);
+    free(connection);
+    return NULL;
+}
+
+static double randomUnit(Pipe *pipe) {
+    return rand_r(&pipe->seed) / ((double)RAND_MAX + 1.0);
+}
+
+// Decides when the chunk leaves the proxy. Called with the pipe locked, in arrival order.
+uint64_t scheduleChunk(Pipe *pipe, Chunk *chunk) {
+    LinkProfile *link = &pipe->link;
+    uint64_t departure = chunk->receiveTime;
+
+    if (link->bandwidthKbps > 0) {
+        uint64_t transmit = (uint64_t)chunk->size * 8 * 1000 / link->bandwidthKbps;
+        if (pipe->linkFree > departure) departure = pipe->linkFree;
+        departure += transmit;
+        pipe->linkFree = departure;
+    }
+
+    int64_t delay = (int64_t)link->latencyMs * 1000;
+    if (link->jitterMs > 0) delay += (int64_t)((randomUnit(pipe) * 2.0 - 1.0) * link->jitterMs * 1000);
+    if (delay < 0) delay = 0;
+
+    if (randomUnit(pipe) * 100.0 < link->lossPercent) {
+        // Retransmitted after an RTO of at least 200 ms or twice the path delay
+        int64_t timeout = 2 * (int64_t)link->latencyMs * 1000;
+        delay += timeout > MIN_RETRANSMIT_MICROS ? timeout : MIN_RETRANSMIT_MICROS;
+        chunk->lost = 1;
+    } else if (randomUnit(pipe) * 100.0 < link->reorderPercent) {
+        // A later segment overtook this one, so the receiver waits for the hole to be filled
+        delay += (int64_t)link->latencyMs * 500 + (int64_t)link->jitterMs * 1000;
+        chunk->reordered = 1;
+    }
+
+    uint64_t deliver = departure + delay;
+    if (deliver < pipe->lastDeliver) deliver = pipe->lastDeliver;
+    pipe->lastDeliver = deliver;
+    return deliver;
+}
+
+void *pipeReader(void *arg) {
+    Pipe *pipe = (Pipe *)arg;
+
+    while (1) {
+        Chunk *chunk = malloc(sizeof(Chunk));
+        ssize_t received = recv(pipe->from, chunk->data, CHUNK_SIZE, 0);
+        if (received <= 0) {
+            free(chunk);
+            break;
+        }
+
+        chunk->size = received;
+        chunk->lost = 0;
+        chunk->reordered = 0;
+        chunk->receiveTime = monotonicMicros();
+        chunk->next = NULL;
+
+        pthread_mutex_lock(&pipe->lock);
+        chunk->seq = pipe->nextSeq++;
+        chunk->deliverTime = scheduleChunk(pipe, chunk);
+        if (pipe->tail != NULL) pipe->tail->next = chunk;
+        else pipe->head = chunk;
+        pipe->tail = chunk;
+        pthread_cond_signal(&pipe->ready);
+        pthread_mutex_unlock(&pipe->lock);
+    }
+
+    pthread_mutex_lock(&pipe->lock);
+    pipe->closed = 1;
+    pthread_cond_signal(&pipe->ready);
+    pthread_mutex_unlock(&pipe->lock);
+    return NULL;
+}
+
+void *pipeWriter(void *arg) {
+    Pipe *pipe = (Pipe *)arg;
+
+    while (1) {
+        pthread_mutex_lock(&pipe->lock);
+        while (pipe->head == NULL && !pipe->closed) {
+            pthread_cond_wait(&pipe->ready, &pipe->lock);
+        }
+        Chunk *chunk = pipe->head;
+        if (chunk == NULL) {
+            pthread_mutex_unlock(&pipe->lock);
+            break;
+        }
+        pipe->head = chunk->next;
+        if (pipe->head == NULL) pipe->tail = NULL;
+        pthread_mutex_unlock(&pipe->lock);
+
+        uint64_t now = monotonicMicros();
+        if (chunk->deliverTime > now) usleep(chunk->deliverTime - now);
+
+        int result = sendAll(pipe->to, chunk->data, chunk->size);
+        recordChunk(pipe, chunk, monotonicMicros());
+        free(chunk);
+        if (result == -1) break;
+    }
+
+    // Pass the half-close on, and stop the reader of this direction if the peer went away
+    shutdown(pipe->to, SHUT_WR);
+    shutdown(pipe->from, SHUT_RD);
+
+    pthread_mutex_lock(&pipe->lock);
+    while (pipe->head != NULL) {
+        Chunk *next = pipe->head->next;
+        free(pipe->head);
+        pipe->head = next;
+    }
+    pipe->tail = NULL;
+    pthread_mutex_unlock(&pipe->lock);
+    return NULL;
+}
+
+void recordChunk(Pipe *pipe, Chunk *chunk, uint64_t sendTime) {
+    DirectionStats *stats = pipe->stats;
+    uint64_t delay = sendTime - chunk->receiveTime;
+
+    pthread_mutex_lock(&stats->lock);
+    if (stats->chunks == 0 || chunk->receiveTime < stats->firstReceive) stats->firstReceive = chunk->receiveTime;
+    if (sendTime > stats->lastSend) stats->lastSend = sendTime;
+    stats->chunks++;
+    stats->bytes += chunk->size;
+    stats->lost += chunk->lost;
+    stats->reordered += chunk->reordered;
+    stats->delays[stats->delayCount % MAX_DELAY_SAMPLES] = delay;
+    stats->delayCount++;
+    pthread_mutex_unlock(&stats->lock);
+
+    pthread_mutex_lock(&logMutex);
+    if (logFile != NULL) {
+        fprintf(logFile, "%d,%s,%d,%d,%llu,%llu,%llu,%llu,%d,%d\n", pipe->connectionID,
+            stats == &upStats ? "up" : "down", chunk->seq, chunk->size,
+            (unsigned long long)chunk->receiveTime, (unsigned long long)chunk->deliverTime,
+            (unsigned long long)sendTime, (unsigned long long)delay, chunk->lost, chunk->reordered);
+    }
+    pthread_mutex_unlock(&logMutex);
+}
+
+static int compareDelays(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return (left > right) - (left < right);
+}
+
+void printReport(DirectionStats *stats, LinkProfile *link) {
+    pthread_mutex_lock(&stats->lock);
+    printf("+--------------------------------------------------+\n");
+    printf("| %-48s |\n", stats->name);
+    printf("+--------------------------------------------------+\n");
+    if (stats->chunks == 0) {
+        printf("| no traffic                                       |\n");
+        printf("+--------------------------------------------------+\n");
+        pthread_mutex_unlock(&stats->lock);
+        return;
+    }
+
+    long long samples = stats->delayCount < MAX_DELAY_SAMPLES ? stats->delayCount : MAX_DELAY_SAMPLES;
+    qsort(stats->delays, samples, sizeof(uint64_t), compareDelays);
+    double elapsed = (stats->lastSend - stats->firstReceive) / 1000000.0;
+    double throughput = elapsed > 0 ? stats->bytes * 8 / 1000.0 / elapsed : 0;
+
+    char line[5][64];
+    snprintf(line[0], sizeof(line[0]), "packets %lld, bytes %lld", stats->chunks, stats->bytes);
+    snprintf(line[1], sizeof(line[1]), "lost %lld, reordered %lld", stats->lost, stats->reordered);
+    snprintf(line[2], sizeof(line[2]), "delay ms p50 %.1f, p95 %.1f, p99 %.1f",
+        stats->delays[samples / 2] / 1000.0, stats->delays[samples * 95 / 100] / 1000.0,
+        stats->delays[samples * 99 / 100] / 1000.0);
+    snprintf(line[3], sizeof(line[3]), "delay ms max %.1f (target %d +/- %d)",
+        stats->delays[samples - 1] / 1000.0, link->latencyMs, link->jitterMs);
+    snprintf(line[4], sizeof(line[4]), "throughput %.1f kbps (cap %d)", throughput, link->bandwidthKbps);
+    for (int i = 0; i < 5; ++i) printf("| %-48s |\n", line[i]);
+    printf("+--------------------------------------------------+\n");
+    pthread_mutex_unlock(&stats->lock);
+}
+
+// Runs the link model over a fixed packet schedule on a simulated clock, so every number depends only
+// on the profile and the seed. Prints the same kind of report as a live run and returns the number
+// of expectations the model missed.
+int runCheck(const char *name, LinkProfile link) {
+    static uint64_t delays[CHECK_PACKETS];
+    Pipe pipe;
+    Chunk chunk;
+    memset(&pipe, 0, sizeof(Pipe));
+    memset(&chunk, 0, sizeof(Chunk));
+    pipe.link = link;
+    pipe.seed = randomSeed * 7919;
+
+    long long lost = 0;
+    long long reordered = 0;
+    long long outOfOrder = 0;
+    uint64_t previousDeliver = 0;
+    for (int i = 0; i < CHECK_PACKETS; ++i) {
+        chunk.size = CHECK_PACKET_SIZE;
+        chunk.lost = 0;
+        chunk.reordered = 0;
+        chunk.receiveTime = (uint64_t)i * CHECK_INTERVAL_MICROS;
+        uint64_t deliver = scheduleChunk(&pipe, &chunk);
+
+        delays[i] = deliver - chunk.receiveTime;
+        lost += chunk.lost;
+        reordered += chunk.reordered;
+        if (deliver < previousDeliver) outOfOrder++;
+        previousDeliver = deliver;
+    }
+
+    // The burst arrives once the link has long been idle, so only the cap decides how fast it drains
+    uint64_t burstStart = (uint64_t)CHECK_PACKETS * CHECK_INTERVAL_MICROS + 10000000;
+    for (int i = 0; i < CHECK_BURST_PACKETS; ++i) {
+        chunk.size = CHUNK_SIZE;
+        chunk.receiveTime = burstStart;
+        scheduleChunk(&pipe, &chunk);
+    }
+    double burstSeconds = pipe.linkFree > burstStart ? (pipe.linkFree - burstStart) / 1000000.0 : 0;
+    double burstKbps = burstSeconds > 0 ? CHECK_BURST_PACKETS * CHUNK_SIZE * 8 / 1000.0 / burstSeconds : 0;
+
+    qsort(delays, CHECK_PACKETS, sizeof(uint64_t), compareDelays);
+    double lossRate = 100.0 * lost / CHECK_PACKETS;
+    double reorderRate = 100.0 * reordered / CHECK_PACKETS;
+    double expectedReorder = (100.0 - link.lossPercent) * link.reorderPercent / 100.0;
+    int64_t transmit = link.bandwidthKbps > 0 ? (int64_t)CHECK_PACKET_SIZE * 8 * 1000 / link.bandwidthKbps : 0;
+    int64_t lowest = ((int64_t)link.latencyMs - link.jitterMs) * 1000 + transmit;
+
+    char line[8][64];
+    int lines = 0;
+    snprintf(line[lines++], sizeof(line[0]), "delay ms p50 %.1f, p95 %.1f, p99 %.1f",
+        delays[CHECK_PACKETS / 2] / 1000.0, delays[CHECK_PACKETS * 95 / 100] / 1000.0,
+        delays[CHECK_PACKETS * 99 / 100] / 1000.0);
+    snprintf(line[lines++], sizeof(line[0]), "min %.1f, max %.1f ms (target %d +/- %d)",
+        delays[0] / 1000.0, delays[CHECK_PACKETS - 1] / 1000.0, link.latencyMs, link.jitterMs);
+    snprintf(line[lines++], sizeof(line[0]), "lost %.2f%% (%.1f), reordered %.2f%% (%.2f)",
+        lossRate, link.lossPercent, reorderRate, expectedReorder);
+    if (link.bandwidthKbps > 0) {
+        snprintf(line[lines++], sizeof(line[0]), "burst %.1f kbps (cap %d)", burstKbps, link.bandwidthKbps);
+    } else {
+        snprintf(line[lines++], sizeof(line[0]), "burst unlimited (cap 0)");
+    }
+
+    // Binomial noise over CHECK_PACKETS is well under 0.5 percentage points for every profile
+    int failures = 0;
+    if (outOfOrder > 0) snprintf(line[lines++], sizeof(line[0]), "FAILED: %lld delivered out of order", outOfOrder), failures++;
+    if ((int64_t)delays[0] < (lowest > 0 ? lowest : 0)) snprintf(line[lines++], sizeof(line[0]), "FAILED: delay below latency - jitter"), failures++;
+    if (lossRate < link.lossPercent - 0.5 || lossRate > link.lossPercent + 0.5) snprintf(line[lines++], sizeof(line[0]), "FAILED: loss rate"), failures++;
+    if (reorderRate < expectedReorder - 0.5 || reorderRate > expectedReorder + 0.5) snprintf(line[lines++], sizeof(line[0]), "FAILED: reorder rate"), failures++;
+    if (link.bandwidthKbps > 0 && (burstKbps < link.bandwidthKbps * 0.99 || burstKbps > link.bandwidthKbps * 1.01)) {
+        snprintf(line[lines++], sizeof(line[0]), "FAILED: burst throughput"), failures++;
+    }
+    if (failures == 0) snprintf(line[lines++], sizeof(line[0]), "ok");
+
+    printf("+--------------------------------------------------+\n");
+    printf("| check %-42s |\n", name);
+    printf("+--------------------------------------------------+\n");
+    for (int i = 0; i < lines; ++i) printf("| %-48s |\n", line[i]);
+    printf("+--------------------------------------------------+\n");
+    return failures;
+}
+
+void handleSignal(int signal) {
+    stopRequested = 1;
+}
@@ -0,0 +1,269 @@
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#include "protocol.h"
+
+// Direction codes used by the chain format, in the order up, right, down, left
+static const int directionX[4] = { 0, SNAKE_SEGMENT_DIMENSION, 0, -SNAKE_SEGMENT_DIMENSION };
+static const int directionY[4] = { -SNAKE_SEGMENT_DIMENSION, 0, SNAKE_SEGMENT_DIMENSION, 0 };
+
+void putU16(uint8_t *buffer, uint16_t value) {
+    buffer[0] = value & 0xFF;
+    buffer[1] = value >> 8;
+}
+
+uint16_t getU16(const uint8_t *buffer) {
+    return (uint16_t)(buffer[0] | (buffer[1] << 8));
+}
+
+void putU32(uint8_t *buffer, uint32_t value) {
+    putU16(buffer, value & 0xFFFF);
+    putU16(buffer + 2, value >> 16);
+}
+
+uint32_t getU32(const uint8_t *buffer) {
+    return getU16(buffer) | ((uint32_t)getU16(buffer + 2) << 16);
+}
+
+void putU64(uint8_t *buffer, uint64_t value) {
+    putU32(buffer, value & 0xFFFFFFFF);
+    putU32(buffer + 4, value >> 32);
+}
+
+uint64_t getU64(const uint8_t *buffer) {
+    return getU32(buffer) | ((uint64_t)getU32(buffer + 4) << 32);
+}
+
+static int directionBetween(SnakeSegment from, SnakeSegment to) {
+    for (int d = 0; d < 4; ++d) {
+        if (to.x - from.x == directionX[d] && to.y - from.y == directionY[d]) return d;
+    }
+    return -1;
+}
+
+// Returns the number of bytes written to buffer (at most SNAKE_CODEC_MAX_SIZE)
+int encodeSnake(const Snake *snake, uint8_t *buffer) {
+    int length = snake->body_length;
+    if (length < 0) length = 0;
+    if (length > MAX_SNAKE_LENGTH - 1) length = MAX_SNAKE_LENGTH - 1;
+
+    uint8_t directions[MAX_SNAKE_LENGTH - 1];
+    int isChain = 1;
+    SnakeSegment previous = snake->head;
+    for (int i = 0; i < length; ++i) {
+        int d = directionBetween(previous, snake->body[i]);
+        if (d < 0) {
+            isChain = 0;
+            break;
+        }
+        directions[i] = d;
+        previous = snake->body[i];
+    }
+
+    buffer[0] = isChain ? SNAKE_FORMAT_CHAIN : SNAKE_FORMAT_RAW;
+    buffer[1] = snake->isAlive ? 1 : 0;
+    putU16(buffer + 2, length);
+    putU16(buffer + 4, (uint16_t)(int16_t)snake->head.x);
+    putU16(buffer + 6, (uint16_t)(int16_t)snake->head.y);
+    int size = SNAKE_CODEC_HEADER_SIZE;
+
+    if (!isChain) {
+        for (int i = 0; i < length; ++i) {
+            putU16(buffer + size, (uint16_t)(int16_t)snake->body[i].x);
+            putU16(buffer + size + 2, (uint16_t)(int16_t)snake->body[i].y);
+            size += 4;
+        }
+        return size;
+    }
+
+    int i = 0;
+    while (i < length) {
+        int run = 1;
+        while (i + run < length && run < 32 && directions[i + run] == directions[i]) run++;
+
+        if (run >= 3) {
+            buffer[size++] = 0x80 | (directions[i] << 5) | (run - 1);
+            i += run;
+        } else {
+            uint8_t literal = 0;
+            for (int k = 0; k < 3; ++k) {
+                int d = (i + k < length) ? directions[i + k] : 0;
+                literal |= d << (4 - 2 * k);
+            }
+            buffer[size++] = literal;
+            i += 3;
+        }
+    }
+    return size;
+}
+
+// Returns the number of bytes consumed from buffer, or -1 if the data is malformed
+int decodeSnake(const uint8_t *buffer, int size, Snake *snake) {
+    if (size < SNAKE_CODEC_HEADER_SIZE) return -1;
+
+    int format = buffer[0];
+    int length = getU16(buffer + 2);
+    if (length > MAX_SNAKE_LENGTH - 1) return -1;
+
+    snake->isAlive = buffer[1];
+    snake->body_length = length;
+    snake->head.x = (int16_t)getU16(buffer + 4);
+    snake->head.y = (int16_t)getU16(buffer + 6);
+    int offset = SNAKE_CODEC_HEADER_SIZE;
+
+    if (format == SNAKE_FORMAT_RAW) {
+        if (size < offset + length * 4) return -1;
+        for (int i = 0; i < length; ++i) {
+            snake->body[i].x = (int16_t)getU16(buffer + offset);
+            snake->body[i].y = (int16_t)getU16(buffer + offset + 2);
+            offset += 4;
+        }
+        return offset;
+    }
+    if (format != SNAKE_FORMAT_CHAIN) return -1;
+
+    SnakeSegment previous = snake->head;
+    int i = 0;
+    while (i < length) {
+        if (offset >= size) return -1;
+        uint8_t code = buffer[offset++];
+
+        if (code & 0x80) {
+            int d = (code >> 5) & 0x03;
+            int run = (code & 0x1F) + 1;
+            if (i + run > length) return -1;
+            for (int k = 0; k < run; ++k) {
+                previous.x += directionX[d];
+                previous.y += directionY[d];
+                snake->body[i++] = previous;
+            }
+        } else {
+            for (int k = 0; k < 3 && i < length; ++k) {
+                int d = (code >> (4 - 2 * k)) & 0x03;
+                previous.x += directionX[d];
+                previous.y += directionY[d];
+                snake->body[i++] = previous;
+            }
+        }
+    }
+    return offset;
+}
+
+// Returns the grid cell under the segment, or -1 if it is off the board or between cells
+int cellIndex(SnakeSegment segment) {
+    if (segment.x < 0 || segment.y < 0) return -1;
+    if (segment.x % SNAKE_SEGMENT_DIMENSION != 0 || segment.y % SNAKE_SEGMENT_DIMENSION != 0) return -1;
+
+    int column = segment.x / SNAKE_SEGMENT_DIMENSION;
+    int row = segment.y / SNAKE_SEGMENT_DIMENSION;
+    if (column >= GRID_COLUMNS || row >= GRID_ROWS) return -1;
+    return row * GRID_COLUMNS + column;
+}
+
+SnakeSegment cellSegment(int cell) {
+    SnakeSegment segment = { (cell % GRID_COLUMNS) * SNAKE_SEGMENT_DIMENSION, (cell / GRID_COLUMNS) * SNAKE_SEGMENT_DIMENSION };
+    return segment;
+}
+
+int sendAll(int socket, const void *buffer, size_t size) {
+    const char *data = buffer;
+    while (size > 0) {
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) return -1;
+        data += sent;
+        size -= sent;
+    }
+    return 0;
+}
+
+// Returns 0 once size bytes have been read, or -1 on disconnection or error
+int recvAll(int socket, void *buffer, size_t size) {
+    char *data = buffer;
+    while (size > 0) {
+        ssize_t received = recv(socket, data, size, 0);
+        if (received <= 0) return -1;
+        data += received;
+        size -= received;
+    }
+    return 0;
+}
+
+// Writes the snake as a u16 byte count followed by its encoding, returns the total size
+int packSnake(const Snake *snake, uint8_t *buffer) {
+    int size = encodeSnake(snake, buffer + 2);
+    putU16(buffer, size);
+    return 2 + size;
+}
+
+// splitmix64 of the (player, cell) pair, so no key table has to be shared between processes
+uint64_t zobristKey(int playerID, SnakeSegment segment) {
+    int cell = cellIndex(segment);
+    if (cell < 0) return 0;
+
+    uint64_t key = ((uint64_t)playerID << 32 | (uint32_t)cell) + 0x9E3779B97F4A7C15ULL;
+    key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+    return key ^ (key >> 31);
+}
+
+uint64_t hashSnake(int playerID, const Snake *snake) {
+    if (!snake->isAlive) return 0;
+
+    uint64_t hash = zobristKey(playerID, snake->head);
+    for (int i = 0; i < snake->body_length; ++i) hash ^= zobristKey(playerID, snake->body[i]);
+    return hash;
+}
+
+// Updates a snake's hash from its previous state: a move of one cell only touches the new head and
+// the freed tail, anything else is hashed from scratch
+uint64_t rehashSnake(uint64_t hash, int playerID, const Snake *previous, const Snake *next) {
+    if (!previous->isAlive || !next->isAlive || previous->body_length < 1 || next->body_length < 1 ||
+        (next->body_length != previous->body_length && next->body_length != previous->body_length + 1) ||
+        next->body[0].x != previous->head.x || next->body[0].y != previous->head.y) {
+        return hashSnake(playerID, next);
+    }
+    for (int i = 1; i < next->body_length; ++i) {
+        if (next->body[i].x != previous->body[i - 1].x || next->body[i].y != previous->body[i - 1].y) {
+            return hashSnake(playerID, next);
+        }
+    }
+
+    hash ^= zobristKey(playerID, next->head);
+    if (next->body_length == previous->body_length) {
+        hash ^= zobristKey(playerID, previous->body[previous->body_length - 1]);
+    }
+    return hash;
+}
+
+// Reads a packed snake from a buffer, returns the number of bytes consumed or -1
+int unpackSnake(const uint8_t *buffer, int size, Snake *snake) {
+    if (size < 2) return -1;
+    int encodedSize = getU16(buffer);
+    if (encodedSize > size - 2) return -1;
+    return decodeSnake(buffer + 2, encodedSize, snake) == encodedSize ? 2 + encodedSize : -1;
+}
+
+int sendSnake(int socket, const Snake *snake) {
+    uint8_t buffer[PACKED_SNAKE_MAX_SIZE];
+    int size = packSnake(snake, buffer);
+    return sendAll(socket, buffer, size);
+}
+
+int recvSnake(int socket, Snake *snake) {
+    uint8_t buffer[SNAKE_CODEC_MAX_SIZE];
+    uint8_t sizeBytes[2];
+    if (recvAll(socket, sizeBytes, 2) == -1) return -1;
+
+    int size = getU16(sizeBytes);
+    if (size > SNAKE_CODEC_MAX_SIZE) return -1;
+    if (recvAll(socket, buffer, size) == -1) return -1;
+
+    return decodeSnake(buffer, size, snake) == size ? 0 : -1;
+}
+
+uint64_t monotonicMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
@@ -0,0 +1,137 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PORT 58501
+#define WINDOW_WIDTH 1200
+#define WINDOW_HEIGHT 700
+#define MAX_CLIENTS 5 // -1 to get the actual Maximum - (which is 4...)
+#define MAX_SNAKE_LENGTH 400
+#define SNAKE_SEGMENT_DIMENSION 15
+
+#define MIN_X 0
+#define MAX_X (WINDOW_WIDTH - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
+#define MIN_Y 0
+#define MAX_Y (WINDOW_HEIGHT - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
+
+// Board Grid - every segment sits on a multiple of SNAKE_SEGMENT_DIMENSION
+#define GRID_COLUMNS (WINDOW_WIDTH / SNAKE_SEGMENT_DIMENSION)
+#define GRID_ROWS (WINDOW_HEIGHT / SNAKE_SEGMENT_DIMENSION)
+#define GRID_CELLS (GRID_COLUMNS * GRID_ROWS)
+
+#define FOOD_COUNT 5 // Food items on the board at once, each one grows its eater by a segment
+
+// Structs
+typedef struct {
+    int x;
+    int y;
+} SnakeSegment;
+
+typedef struct {
+    SnakeSegment head;
+    SnakeSegment body[MAX_SNAKE_LENGTH - 1]; // -1 for excluding head
+    int body_length;
+    int isAlive;
+} Snake;
+
+typedef struct{
+    int deltaX, deltaY;
+} Movement;
+
+int cellIndex(SnakeSegment segment);
+SnakeSegment cellSegment(int cell);
+
+// World Hash
+// Zobrist hashing: every (player, cell) pair has a fixed pseudo-random 64-bit key, and a snake's hash
+// is the XOR of the keys under its live segments (0 for a dead snake). A segment entering or leaving
+// a cell changes the hash with one XOR, and the world hash is the XOR of every snake's hash.
+uint64_t zobristKey(int playerID, SnakeSegment segment);
+uint64_t hashSnake(int playerID, const Snake *snake);
+uint64_t rehashSnake(uint64_t hash, int playerID, const Snake *previous, const Snake *next);
+
+// Snake Codec
+// Encoded layout (little-endian):
+//   [u8 format][u8 isAlive][u16 body_length][i16 head.x][i16 head.y][body...]
+// SNAKE_FORMAT_CHAIN stores the body as the direction from each segment to the next one,
+// packed into bytes of either a run (1ddnnnnn: direction dd repeated nnnnn + 1 times)
+// or a literal (00aabbcc: three single directions, aa first).
+// SNAKE_FORMAT_RAW stores every body segment as (i16 x, i16 y) and is only used when the
+// body is not a contiguous chain.
+#define SNAKE_FORMAT_CHAIN 1
+#define SNAKE_FORMAT_RAW 2
+#define SNAKE_CODEC_HEADER_SIZE 8
+#define SNAKE_CODEC_MAX_SIZE (SNAKE_CODEC_HEADER_SIZE + (MAX_SNAKE_LENGTH - 1) * 4)
+#define PACKED_SNAKE_MAX_SIZE (2 + SNAKE_CODEC_MAX_SIZE) // u16 byte count + encoding
+
+int encodeSnake(const Snake *snake, uint8_t *buffer);
+int decodeSnake(const uint8_t *buffer, int size, Snake *snake);
+int packSnake(const Snake *snake, uint8_t *buffer);
+int unpackSnake(const uint8_t *buffer, int size, Snake *snake);
+
+// Messages
+// The first byte of every message after the join handshake is its type.
+// Client -> Server
+//   MSG_SNAKE: [int playerID][u32 targetTick][u64 sendTime][packed snake]
+//   MSG_PING:  [u64 clientSendTime][u32 smoothedRTT][u32 rttJitter]
+//   MSG_KEYFRAME_REQUEST: no payload
+// Server -> Client
+//   MSG_SNAKE: [int startSignal][int senderID][u32 tick][packed snake], a snake with its head
+//              at -1,-1 and no body means the sender left the match
+//   MSG_PONG:  [u64 clientSendTime][u64 serverReceiveTime][u64 serverSendTime]
+//   MSG_HASH:  [u32 tick][u64 worldHash], the hash leaves out the recipient's own snake
+//   MSG_KEYFRAME: [u32 tick][u8 count] then count x [u8 playerID][packed snake], every other
+//              player in the match; a player that is not listed has left
+//   MSG_FOOD:  [u32 tick][u8 count] then count x [u16 cell], every food item on the board
+//   MSG_GROW:  [u32 tick][u8 segments], sent to a player whose snake ate; the client grows its
+//              snake by keeping the tail on its next moves, the server refuses any other growth
+// Times are in microseconds. Server times count from the server's start, and a client
+// converts its own clock with the offset estimated from pongs (0 = not synchronized yet).
+// A tick's snakes and its hash reach a client together, so the client checks its copy of the
+// world against every hash it receives and asks for a keyframe when they differ.
+#define MSG_SNAKE 1
+#define MSG_PING 2
+#define MSG_PONG 3
+#define MSG_HASH 4
+#define MSG_KEYFRAME_REQUEST 5
+#define MSG_KEYFRAME 6
+#define MSG_FOOD 7
+#define MSG_GROW 8
+#define SNAKE_MESSAGE_HEADER_SIZE (1 + 2 * sizeof(int) + 12)
+#define SNAKE_MESSAGE_MAX_SIZE (SNAKE_MESSAGE_HEADER_SIZE + PACKED_SNAKE_MAX_SIZE)
+#define PING_MESSAGE_SIZE (1 + 16)
+#define PONG_MESSAGE_SIZE (1 + 24)
+#define HASH_MESSAGE_SIZE (1 + 12)
+#define KEYFRAME_HEADER_SIZE (1 + 5)
+#define KEYFRAME_MESSAGE_MAX_SIZE (KEYFRAME_HEADER_SIZE + MAX_CLIENTS * (1 + PACKED_SNAKE_MAX_SIZE))
+#define FOOD_HEADER_SIZE (1 + 5)
+#define FOOD_MESSAGE_MAX_SIZE (FOOD_HEADER_SIZE + FOOD_COUNT * 2)
+#define GROW_MESSAGE_SIZE (1 + 5)
+#define MAX_MESSAGE_SIZE KEYFRAME_MESSAGE_MAX_SIZE
+
+// Replay File
+// REPLAY_MAGIC, then one record per snake update:
+//   [u32 milliseconds since the recording started][u8 playerID][u16 size][encoded snake]
+#define REPLAY_MAGIC "SNR1"
+#define REPLAY_RECORD_HEADER_SIZE 7
+
+#define TICK_MICROS 50000 // Server tick, matches the client's frame delay
+#define PING_INTERVAL_MICROS 1000000
+
+void putU16(uint8_t *buffer, uint16_t value);
+uint16_t getU16(const uint8_t *buffer);
+void putU32(uint8_t *buffer, uint32_t value);
+uint32_t getU32(const uint8_t *buffer);
+void putU64(uint8_t *buffer, uint64_t value);
+uint64_t getU64(const uint8_t *buffer);
+
+// Socket Helpers
+int sendAll(int socket, const void *buffer, size_t size);
+int recvAll(int socket, void *buffer, size_t size);
+int sendSnake(int socket, const Snake *snake);
+int recvSnake(int socket, Snake *snake);
+
+uint64_t monotonicMicros();
+
+#endif
@@ -0,0 +1,142 @@
+// Replay reader: reads a file recorded with ./server replay.bin back and checks every record.
+// Each snake is decoded and encoded again, and must come out as the same bytes the server wrote.
+//
+// Usage: ./replay-reader [-v] replay.bin
+//   -v prints every record instead of only the summary
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "protocol.h"
+
+typedef struct {
+    long long records;
+    uint32_t firstTime; // Milliseconds since the recording started
+    uint32_t lastTime;
+    int length; // Head included, in the last record
+    int isAlive;
+    int left; // Last record was the -1,-1 snake the server sends when the player leaves
+} PlayerSummary;
+
+PlayerSummary summaries[MAX_CLIENTS];
+long long badRecords = 0; // Did not decode, or did not encode back to the same bytes
+long long outOfOrder = 0; // Recorded earlier than the record before it
+
+int readRecord(FILE *file, int verbose);
+void printReport(long long records, int truncated);
+
+int main(int argc, char *argv[]) {
+    int verbose = 0;
+
+    int option;
+    while ((option = getopt(argc, argv, "v")) != -1) {
+        if (option == 'v') {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-v] replay.bin\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-v] replay.bin\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *file = fopen(argv[optind], "rb");
+    if (file == NULL) {
+        perror("Error opening replay file");
+        exit(EXIT_FAILURE);
+    }
+
+    char magic[4];
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, REPLAY_MAGIC, 4) != 0) {
+        fprintf(stderr, "%s is not a replay file\n", argv[optind]);
+        fclose(file);
+        exit(EXIT_FAILURE);
+    }
+
+    long long records = 0;
+    int result;
+    while ((result = readRecord(file, verbose)) == 0) records++;
+    fclose(file);
+
+    // A server that was killed can leave a partly written record at the end
+    printReport(records, result == -1);
+    return badRecords == 0 && outOfOrder == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Returns 0 after a record, 1 at the end of the file and -1 if the file ends inside a record
+int readRecord(FILE *file, int verbose) {
+    static uint32_t previousTime = 0;
+    uint8_t header[REPLAY_RECORD_HEADER_SIZE];
+    uint8_t encoded[SNAKE_CODEC_MAX_SIZE];
+    uint8_t reencoded[SNAKE_CODEC_MAX_SIZE];
+
+    size_t got = fread(header, 1, sizeof(header), file);
+    if (got == 0) return 1;
+    if (got != sizeof(header)) return -1;
+
+    uint32_t time = getU32(header);
+    int playerID = header[4];
+    int size = getU16(header + 5);
+    if (size > SNAKE_CODEC_MAX_SIZE) {
+        // The size is all that marks where the next record starts, nothing after it can be trusted
+        badRecords++;
+        return -1;
+    }
+    if (fread(encoded, 1, size, file) != (size_t)size) return -1;
+
+    Snake snake;
+    int valid = playerID >= 1 && playerID < MAX_CLIENTS && decodeSnake(encoded, size, &snake) == size &&
+        encodeSnake(&snake, reencoded) == size && memcmp(encoded, reencoded, size) == 0;
+    if (time < previousTime) outOfOrder++;
+    previousTime = time;
+    if (!valid) {
+        badRecords++;
+        if (verbose) printf("%10u ms  player %d  bad record (%d bytes)\n", time, playerID, size);
+        return 0;
+    }
+
+    PlayerSummary *summary = &summaries[playerID - 1];
+    if (summary->records == 0) summary->firstTime = time;
+    summary->records++;
+    summary->lastTime = time;
+    summary->length = snake.body_length + 1;
+    summary->isAlive = snake.isAlive;
+    summary->left = snake.head.x == -1 && snake.head.y == -1 && snake.body_length == 0;
+
+    if (verbose && summary->left) {
+        printf("%10u ms  player %d  left\n", time, playerID);
+    } else if (verbose) {
+        printf("%10u ms  player %d  head (%d, %d)  length %d%s\n", time, playerID,
+            snake.head.x, snake.head.y, snake.body_length + 1, snake.isAlive ? "" : "  dead");
+    }
+    return 0;
+}
+
+void printReport(long long records, int truncated) {
+    char line[MAX_CLIENTS + 1][64];
+    int lines = 0;
+
+    snprintf(line[lines++], sizeof(line[0]), "records %lld, bad %lld, out of order %lld%s",
+        records, badRecords, outOfOrder, truncated ? ", truncated" : "");
+    for (int p = 0; p < MAX_CLIENTS - 1; ++p) {
+        PlayerSummary *summary = &summaries[p];
+        if (summary->records == 0) continue;
+        if (summary->left) {
+            snprintf(line[lines++], sizeof(line[0]), "player %d: %lld, %u-%u ms, left", p + 1,
+                summary->records, summary->firstTime, summary->lastTime);
+            continue;
+        }
+        snprintf(line[lines++], sizeof(line[0]), "player %d: %lld, %u-%u ms, length %d, %s", p + 1,
+            summary->records, summary->firstTime, summary->lastTime, summary->length,
+            summary->isAlive ? "alive" : "dead");
+    }
+
+    printf("+--------------------------------------------------+\n");
+    printf("| %-48s |\n", "replay");
+    printf("+--------------------------------------------------+\n");
+    for (int i = 0; i < lines; ++i) printf("| %-48s |\n", line[i]);
+    printf("+--------------------------------------------------+\n");
+}
@@ -7,17 +7,9 @@
 #include <pthread.h>
 #include <netinet/tcp.h>
 
-#define PORT 58501
-#define WINDOW_WIDTH 1200
-#define WINDOW_HEIGHT 700
-#define MAX_CLIENTS 5 // -1 to get the actual Maximum - (which is 4...)
-#define MAX_SNAKE_LENGTH 100
-#define SNAKE_SEGMENT_DIMENSION 15
-
-#define MIN_X 0
-#define MAX_X (WINDOW_WIDTH - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
-#define MIN_Y 0
-#define MAX_Y (WINDOW_HEIGHT - SNAKE_SEGMENT_DIMENSION) // Adjusted for the snake's head size
+#include "protocol.h"
+#include "simulation.h"
+#include "shmtransport.h"
 
 // Structs
 typedef struct{
@@ -25,21 +17,41 @@ typedef struct{
     int playerID;
 } PlayerInfo;
 
+// Outbound Messages
+#define SEND_QUEUE_CAPACITY 32
+
 typedef struct {
-    int x;
-    int y;
-} SnakeSegment;
+    uint8_t *data; // MAX_MESSAGE_SIZE bytes owned by the queue, only the pointer moves between entries
+    int size; // 0 once a newer message with the same key replaced it, the writer skips it
+    int key; // An unsent message is replaced by a newer one with the same key, 0 is never replaced
+} OutboundMessage;
+
+// Keys 1 to MAX_CLIENTS - 1 are the senders of snake messages
+#define HASH_MESSAGE_KEY MAX_CLIENTS
+#define KEYFRAME_MESSAGE_KEY (MAX_CLIENTS + 1)
 
+// Bounded FIFO drained by one writer thread per client, so a slow client never blocks the others
 typedef struct {
-    SnakeSegment head;
-    SnakeSegment body[MAX_SNAKE_LENGTH - 1]; // -1 for excluding head
-    int body_length;
-    int isAlive;
-} Snake;
+    OutboundMessage messages[SEND_QUEUE_CAPACITY];
+    int head;
+    int count;
+    int closed;
+    int droppedMessages;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+} SendQueue;
+
+// Snake updates wait in an InputBuffer until the tick they were stamped for
+#define MAX_INPUT_LEAD_TICKS 20 // Targets further ahead than this are treated as bad clocks
 
-typedef struct{
-    int deltaX, deltaY;
-} Movement;
+typedef struct {
+    uint32_t smoothedRTT; // Reported by the client from its pings
+    uint32_t rttJitter;
+    uint32_t inputLatency; // Smoothed client send -> applied on the server tick
+    int lateInputs; // Arrived after the tick they targeted
+    int appliedInputs;
+    int keyframes; // Sent because the client's world hash did not match
+} ConnectionStats;
 
 typedef struct {
     int clientSocket;
@@ -47,42 +59,117 @@ typedef struct {
     Snake playerSnake;
     Movement playerMovement;
     int active;
+    int deathFlag;
+    SendQueue sendQueue;
+    pthread_t writerThread;
+    InputBuffer inputs;
+    int keyframeRequested;
+    int foodRequested; // Joined since food last changed
+    ConnectionStats stats;
 } PlayerData;
 
+// Everything one tick sends to the clients
+typedef struct {
+    uint32_t tick;
+    uint8_t snakeMessages[MAX_CLIENTS][SNAKE_MESSAGE_MAX_SIZE];
+    int snakeSizes[MAX_CLIENTS]; // 0 when the snake did not change
+    int includeSender[MAX_CLIENTS];
+    uint8_t keyframe[KEYFRAME_MESSAGE_MAX_SIZE];
+    int keyframeSize;
+    int wantsKeyframe[MAX_CLIENTS];
+    uint8_t food[FOOD_MESSAGE_MAX_SIZE];
+    int foodSize;
+    int foodChanged;
+    int wantsFood[MAX_CLIENTS];
+    int recipient[MAX_CLIENTS]; // Player was active when the tick was built
+    int ate[MAX_CLIENTS];
+    uint64_t worldHash;
+    uint64_t snakeHash[MAX_CLIENTS];
+} TickBroadcast;
+
 // Global Variables/Arrays
 int serverSocket;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 PlayerData players[MAX_CLIENTS];
 int startSignal = 0;
 int winFlag = 0;
+uint64_t serverStart;
+World world; // Guarded by mutex, advanced by the tick thread
+WorkPool *simulationPool;
+
+#define SIMULATION_MAX_THREADS 8
+
+// Replay Recording
+FILE *replayFile = NULL;
+uint64_t replayStart;
+pthread_mutex_t replayMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Local Agents
+const char *localTransportName = NULL;
+SharedTransport localTransport; // Player slots are claimed here when it is enabled
+int nextPlayerID = 1;
+
+// Dashboard
+int statusRequested = 0; // Guarded by statusMutex, the status thread reprints the dashboard when set
+pthread_mutex_t statusMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t statusReady = PTHREAD_COND_INITIALIZER;
 
 void startServer();
 void initPlayer(PlayerInfo *playerInfo, Snake *playerSnake, Movement *startingMovement);
 void *playerHandler(void *arg);
 void *inputHandler(void *arg);
-void broadcastSnakes(int senderID, Snake* playerSnake);
+void *tickHandler(void *arg);
+uint64_t serverClock();
+void queueInput(int playerID, Snake *snake, uint32_t targetTick, uint64_t sendTime);
+void applyInputs(uint32_t tick);
+int buildSnakeMessage(int senderID, uint32_t tick, Snake* playerSnake, uint8_t *message);
+int buildKeyframe(uint32_t tick, uint8_t *message);
+int buildFoodMessage(uint32_t tick, uint8_t *message);
+void broadcastTick(TickBroadcast *broadcast);
+void enqueueMessage(SendQueue *queue, const uint8_t *data, int size, int key);
+void pushMessage(SendQueue *queue, const uint8_t *data, int size, int key);
+void closeSendQueue(SendQueue *queue);
+void *writerHandler(void *arg);
+void openReplay(const char *path);
+void recordReplayFrame(int playerID, Snake* playerSnake);
+int claimPlayerSlot();
+void serviceLocalAgents(uint32_t tick);
+int buildWorldFrame(uint32_t tick, uint8_t *frame);
+void requestGameStatus();
+void *statusHandler(void *arg);
 
 // Temporary Functions //
 void printGameStatus();
+void printNetworkStats();
 char* checkStatus(PlayerData currentPlayer, int playersAlive);
 
-int main() {
+int main(int argc, char *argv[]) {
+    // ./server [-m shared-memory-name] [replay.bin]
+    int option;
+    while ((option = getopt(argc, argv, "m:")) != -1) {
+        if (option == 'm') {
+            localTransportName = optarg;
+        } else {
+            fprintf(stderr, "Usage: %s [-m shared-memory-name] [replay.bin]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (optind < argc) openReplay(argv[optind]);
+
     startServer();
-    
-    // player ID Counter
-    int playerID = 1;
 
     while (1) {
-        if (playerID < MAX_CLIENTS) {
-            // Accept a client connection
-            int *clientSocket = malloc(sizeof(int));
-            *clientSocket = accept(serverSocket, NULL, NULL);
-            if (*clientSocket == -1) {
-                perror("Error accepting client connection");
-                close(serverSocket);
-                exit(EXIT_FAILURE);
-            }
+        // Accept a client connection
+        int *clientSocket = malloc(sizeof(int));
+        *clientSocket = accept(serverSocket, NULL, NULL);
+        if (*clientSocket == -1) {
+            perror("Error accepting client connection");
+            close(serverSocket);
+            exit(EXIT_FAILURE);
+        }
 
+        int playerID = claimPlayerSlot();
+        if (playerID != -1) {
             // Create client info to pass to the thread
             PlayerInfo *playerInfo = malloc(sizeof(PlayerInfo));
             playerInfo->clientSocket = *clientSocket;
@@ -99,18 +186,11 @@ int main() {
             pthread_detach(clientThread);
 
             printGameStatus();
-            playerID++;
         } else {
-            // Accepts a socket then Denies Socket
-            int *deniedSocket = malloc(sizeof(int));
-            *deniedSocket = accept(serverSocket, NULL, NULL);
-            if (*deniedSocket == -1) {
-                perror("Error accepting client connection");
-                close(serverSocket);
-                exit(EXIT_FAILURE);
-            }
+            // Denies the socket
             perror("Connection Denied: Max number of players reached\n");
-            close(*deniedSocket);
+            close(*clientSocket);
+            free(clientSocket);
         }
     }
 
@@ -124,15 +204,28 @@ void *playerHandler(void *arg) {
     PlayerInfo *playerInfo = (PlayerInfo *)arg;
     int clientSocket = playerInfo->clientSocket;
     int playerID = playerInfo->playerID;
-    int deathFlag = 0;
 
     Snake playerSnake;
     Movement startingPosition;
     initPlayer(playerInfo, &playerSnake, &startingPosition);
 
-    send(clientSocket, &playerID, sizeof(int), 0);
-    send(clientSocket, &playerSnake, sizeof(Snake), 0);
-    send(clientSocket, &startingPosition, sizeof(Movement), 0);
+    // A client that hangs up during the handshake only ends its own connection
+    if (sendAll(clientSocket, &playerID, sizeof(int)) == -1 ||
+        sendSnake(clientSocket, &playerSnake) == -1 ||
+        sendAll(clientSocket, &startingPosition, sizeof(Movement)) == -1) {
+        printf("Player %d disconnected.\n", playerID);
+        close(clientSocket);
+        free(arg);
+        return NULL;
+    }
+
+    SendQueue *sendQueue = &players[playerID - 1].sendQueue;
+    pthread_mutex_lock(&sendQueue->lock);
+    sendQueue->head = 0;
+    sendQueue->count = 0;
+    sendQueue->closed = 0;
+    sendQueue->droppedMessages = 0;
+    pthread_mutex_unlock(&sendQueue->lock);
 
     pthread_mutex_lock(&mutex);
     players[playerID - 1].clientSocket = clientSocket;
@@ -140,58 +233,237 @@ void *playerHandler(void *arg) {
     players[playerID - 1].playerSnake = playerSnake;
     players[playerID - 1].playerMovement = startingPosition;
     players[playerID - 1].active = 1;
+    players[playerID - 1].deathFlag = 0;
+    players[playerID - 1].inputs.count = 0;
+    players[playerID - 1].keyframeRequested = 1; // Snakes that stay still are only sent when they move, so start from a full copy
+    players[playerID - 1].foodRequested = 1;
+    memset(&players[playerID - 1].stats, 0, sizeof(ConnectionStats));
     pthread_mutex_unlock(&mutex);
 
-    while (1) {
-        // Receive updated snake position from the client
-        int playerID;
-        Snake receivedSnake;
+    if (pthread_create(&players[playerID - 1].writerThread, NULL, writerHandler, &players[playerID - 1]) != 0) {
+        perror("Error creating writer thread");
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
 
-        recv(clientSocket, &playerID, sizeof(int), 0);        
-        int bytesReceived = recv(clientSocket, &receivedSnake, sizeof(Snake), 0);
+    while (1) {
+        uint8_t type;
+        int result = recvAll(clientSocket, &type, 1);
+
+        if (result == 0 && type == MSG_SNAKE) {
+            // Receive updated snake position from the client, it is applied on its target tick
+            int senderID;
+            uint8_t schedule[12];
+            Snake receivedSnake;
+
+            result = recvAll(clientSocket, &senderID, sizeof(int));
+            if (result == 0) result = recvAll(clientSocket, schedule, sizeof(schedule));
+            if (result == 0) result = recvSnake(clientSocket, &receivedSnake);
+            if (result == 0 && senderID == playerID) {
+                queueInput(playerID, &receivedSnake, getU32(schedule), getU64(schedule + 4));
+            }
+        } else if (result == 0 && type == MSG_KEYFRAME_REQUEST) {
+            // Sent by the next tick, together with that tick's hash
+            pthread_mutex_lock(&mutex);
+            players[playerID - 1].keyframeRequested = 1;
+            players[playerID - 1].stats.keyframes++;
+            pthread_mutex_unlock(&mutex);
+        } else if (result == 0 && type == MSG_PING) {
+            uint8_t ping[PING_MESSAGE_SIZE - 1];
+            uint64_t receiveTime = serverClock();
+            result = recvAll(clientSocket, ping, sizeof(ping));
+            if (result == 0) {
+                pthread_mutex_lock(&mutex);
+                players[playerID - 1].stats.smoothedRTT = getU32(ping + 8);
+                players[playerID - 1].stats.rttJitter = getU32(ping + 12);
+                pthread_mutex_unlock(&mutex);
+
+                // The writer stamps the server send time right before the pong goes out
+                uint8_t pong[PONG_MESSAGE_SIZE];
+                pong[0] = MSG_PONG;
+                memcpy(pong + 1, ping, 8);
+                putU64(pong + 9, receiveTime);
+                putU64(pong + 17, 0);
+                enqueueMessage(sendQueue, pong, sizeof(pong), 0);
+            }
+        } else if (result == 0) {
+            printf("Player %d sent an unknown message.\n", playerID);
+            result = -1;
+        }
 
         // Handle disconnection or error
-        if (bytesReceived <= 0) {
+        if (result == -1) {
             printf("Player %d disconnected.\n", playerID);
             pthread_mutex_lock(&mutex);
             players[playerID - 1].active = 0;
             pthread_mutex_unlock(&mutex);
-            deathFlag = 0;
             break; // Exit the loop on disconnection
         }
+    }
 
-        if (!(receivedSnake.isAlive) && winFlag == 0) {
-            pthread_mutex_lock(&mutex);
-            players[playerID - 1].playerSnake = receivedSnake;
-            pthread_mutex_unlock(&mutex);
+    // Wake the writer even if it is blocked in send()
+    closeSendQueue(sendQueue);
+    shutdown(clientSocket, SHUT_RDWR);
+    pthread_join(players[playerID - 1].writerThread, NULL);
+
+    close(clientSocket);
+    free(arg);
+    return NULL;
+}
+
+uint64_t serverClock() {
+    return monotonicMicros() - serverStart;
+}
+
+void queueInput(int playerID, Snake *snake, uint32_t targetTick, uint64_t sendTime) {
+    PlayerData *player = &players[playerID - 1];
+    uint64_t now = serverClock();
+    uint32_t currentTick = now / TICK_MICROS;
 
+    // This tick's inputs were already applied when it started, so a target of currentTick is late too
+    pthread_mutex_lock(&mutex);
+    if (targetTick <= currentTick) {
+        if (targetTick != 0) player->stats.lateInputs++;
+        targetTick = currentTick;
+    } else if (targetTick > currentTick + MAX_INPUT_LEAD_TICKS) {
+        targetTick = currentTick;
+    }
+
+    PendingInput input = { *snake, targetTick, sendTime, now };
+    insertInput(&player->inputs, &input);
+    pthread_mutex_unlock(&mutex);
+}
+
+// Applies each player's next snake update due on this tick, runs the collision step and broadcasts the results
+void applyInputs(uint32_t tick) {
+    Snake updates[MAX_CLIENTS];
+    int hasUpdate[MAX_CLIENTS] = {0};
+    int present[MAX_CLIENTS];
+    int departed[MAX_CLIENTS];
+    int killed[MAX_CLIENTS];
+    Snake updatedSnakes[MAX_CLIENTS];
+    int updated[MAX_CLIENTS] = {0};
+    uint8_t frame[WORLD_FRAME_MAX_SIZE];
+    int frameSize = 0;
+    int statusChanged = 0; // Handed to the status thread once the mutex is released, printGameStatus() forks
+    static TickBroadcast broadcast; // Only used by the tick thread, too large for its stack
+
+    serviceLocalAgents(tick);
+    uint64_t now = serverClock();
+
+    pthread_mutex_lock(&mutex);
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        PlayerData *player = &players[p];
+        present[p] = player->active;
+        departed[p] = world.present[p] && !player->active;
+        if (!player->active) continue;
+
+        // One input per tick, a second one due now waits for the next tick's collision step
+        PendingInput input;
+        if (takeDueInput(&player->inputs, tick, &input)) {
+            if (input.sendTime != 0 && now > input.sendTime) {
+                uint32_t latency = now - input.sendTime;
+                if (player->stats.appliedInputs == 0) player->stats.inputLatency = latency;
+                else player->stats.inputLatency += ((int64_t)latency - player->stats.inputLatency) / 8;
+            }
+            player->stats.appliedInputs++;
+            updates[p] = input.snake;
+            hasUpdate[p] = 1;
+        } else if (!world.present[p]) {
+            // Just joined: enter the match with the snake from initPlayer()
+            updates[p] = player->playerSnake;
+            hasUpdate[p] = 1;
+        }
+    }
+
+    stepWorld(&world, updates, hasUpdate, present, killed, simulationPool);
+
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        if (!present[p] || (!hasUpdate[p] && !killed[p])) continue;
+        players[p].playerSnake = world.snakes[p];
+        updatedSnakes[p] = world.snakes[p];
+        updated[p] = 1;
+    }
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        // Head at -1,-1 tells the clients the player left, they clear the snake and its hash like the world did
+        if (!departed[p]) continue;
+        memset(&updatedSnakes[p], 0, sizeof(Snake));
+        updatedSnakes[p].head.x = -1;
+        updatedSnakes[p].head.y = -1;
+        updated[p] = 1;
+    }
+
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        PlayerData *player = &players[p];
+        if (!updated[p] || departed[p]) continue;
+
+        if (!(player->playerSnake.isAlive) && winFlag == 0) {
             int playersAlive = 0;
             for (int i = 0; i < 3; i++) {
                 if (players[i].playerSnake.isAlive) playersAlive++;
             }
 
             if (playersAlive == 1) {
-                printGameStatus();
+                statusChanged = 1;
                 winFlag = 1;
             }
 
-            if (deathFlag == 0) {
-                printGameStatus();
-                deathFlag = 1;
+            if (player->deathFlag == 0) {
+                statusChanged = 1;
+                player->deathFlag = 1;
             }
         }
+    }
+
+    broadcast.tick = tick;
+    broadcast.worldHash = world.hash;
+    broadcast.keyframeSize = 0;
+    broadcast.foodChanged = world.foodChanged;
+    broadcast.foodSize = buildFoodMessage(tick, broadcast.food);
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        broadcast.recipient[p] = players[p].active;
+        broadcast.snakeHash[p] = world.snakeHash[p];
+        broadcast.ate[p] = world.ate[p];
+        broadcast.wantsFood[p] = players[p].foodRequested || players[p].keyframeRequested;
+        players[p].foodRequested = 0;
+        broadcast.wantsKeyframe[p] = players[p].active && players[p].keyframeRequested;
+        if (!broadcast.wantsKeyframe[p]) continue;
+        players[p].keyframeRequested = 0;
+        if (broadcast.keyframeSize == 0) broadcast.keyframeSize = buildKeyframe(tick, broadcast.keyframe);
+    }
+    if (localTransportName != NULL) frameSize = buildWorldFrame(tick, frame);
+    pthread_mutex_unlock(&mutex);
 
-        // Update the server's representation of the client's snake
-        pthread_mutex_lock(&mutex);
-        players[playerID - 1].playerSnake = receivedSnake;
-        pthread_mutex_unlock(&mutex);
+    if (statusChanged) requestGameStatus();
+    if (frameSize > 0) shmPublishFrame(&localTransport, frame, frameSize);
 
-        // Broadcast updated snake positions to other players
-        broadcastSnakes(playerID, &receivedSnake);
+    // Broadcast updated snake positions to other players, a snake killed by the server goes to its owner too
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        broadcast.snakeSizes[p] = 0;
+        if (!updated[p]) continue;
+        broadcast.snakeSizes[p] = buildSnakeMessage(p + 1, tick, &updatedSnakes[p], broadcast.snakeMessages[p]);
+        broadcast.includeSender[p] = killed[p];
+        recordReplayFrame(p + 1, &updatedSnakes[p]);
     }
+    broadcastTick(&broadcast);
+}
 
-    close(clientSocket);
-    free(arg);
+void *tickHandler(void *arg) {
+    uint32_t tick = serverClock() / TICK_MICROS;
+
+    while (1) {
+        applyInputs(tick);
+
+        // Sleep until the start of the next tick, skipping ticks only if we fell behind
+        tick++;
+        uint64_t now = serverClock();
+        uint64_t nextTick = (uint64_t)tick * TICK_MICROS;
+        if (now < nextTick) {
+            usleep(nextTick - now);
+        } else {
+            tick = now / TICK_MICROS;
+        }
+    }
     return NULL;
 }
 
@@ -225,7 +497,7 @@ void initPlayer(PlayerInfo *playerInfo, Snake *playerSnake, Movement *startingMo
             break;
         case 3: // Bottom-left
             playerSnake->head.x  = 0;
-            playerSnake->head.y  = WINDOW_HEIGHT - SNAKE_SEGMENT_DIMENSION;
+            playerSnake->head.y  = (GRID_ROWS - 1) * SNAKE_SEGMENT_DIMENSION; // Bottom row of the grid
             startingMovement->deltaX = SNAKE_SEGMENT_DIMENSION;
             startingMovement->deltaY = 0;
 
@@ -237,7 +509,7 @@ void initPlayer(PlayerInfo *playerInfo, Snake *playerSnake, Movement *startingMo
             break;
         case 4: // Bottom-right
             playerSnake->head.x = WINDOW_WIDTH - SNAKE_SEGMENT_DIMENSION;
-            playerSnake->head.y = WINDOW_HEIGHT - SNAKE_SEGMENT_DIMENSION;
+            playerSnake->head.y = (GRID_ROWS - 1) * SNAKE_SEGMENT_DIMENSION; // Bottom row of the grid
             startingMovement->deltaX = -SNAKE_SEGMENT_DIMENSION;
             startingMovement->deltaY = 0;
 
@@ -260,9 +532,17 @@ void *inputHandler(void *arg) {
         if (strcmp(input, "quit\n") == 0) {
             system("clear");
             printf("Server shutting down...\n");
+            pthread_mutex_lock(&replayMutex);
+            if (replayFile != NULL) fclose(replayFile);
+            replayFile = NULL;
+            pthread_mutex_unlock(&replayMutex);
+            if (localTransportName != NULL) shmDetach(&localTransport);
             close(serverSocket);
             exit(EXIT_SUCCESS);
         }
+        if (strcmp(input, "stats\n") == 0) {
+            printNetworkStats();
+        }
         if (strcmp(input, "start\n") == 0) {
             startSignal = 1;
             system("clear");
@@ -306,6 +586,16 @@ void startServer(){
         players[i].clientSocket = -1;
         players[i].playerID = -1;
         players[i].active = 0;
+        pthread_mutex_init(&players[i].sendQueue.lock, NULL);
+        pthread_cond_init(&players[i].sendQueue.ready, NULL);
+        for (int j = 0; j < SEND_QUEUE_CAPACITY; ++j) {
+            players[i].sendQueue.messages[j].data = malloc(MAX_MESSAGE_SIZE);
+            if (players[i].sendQueue.messages[j].data == NULL) {
+                perror("Error allocating send queues");
+                close(serverSocket);
+                exit(EXIT_FAILURE);
+            }
+        }
     }
 
     pthread_t inputThread;
@@ -314,21 +604,374 @@ void startServer(){
         close(serverSocket);
         exit(EXIT_FAILURE);
     }
+
+    if (initWorld(&world, MAX_CLIENTS, monotonicMicros()) == -1) {
+        perror("Error creating the world");
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
+
+    // The parallel phases of stepWorld only split matches with more than SIMULATION_GRAIN snakes, a
+    // smaller match always steps inline on the tick thread, so its workers would never be woken
+    if (world.snakeCount > SIMULATION_GRAIN) {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        int simulationThreads = processors > 1 ? (processors - 1 < SIMULATION_MAX_THREADS ? processors - 1 : SIMULATION_MAX_THREADS) : 0;
+        simulationPool = createWorkPool(simulationThreads);
+    }
+
+    serverStart = monotonicMicros();
+    if (localTransportName != NULL && shmCreate(&localTransport, localTransportName, serverStart) == -1) {
+        perror("Error creating the shared memory transport");
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_t statusThread;
+    if (pthread_create(&statusThread, NULL, statusHandler, NULL) != 0) {
+        perror("Error creating status thread");
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
+
+    pthread_t tickThread;
+    if (pthread_create(&tickThread, NULL, tickHandler, NULL) != 0) {
+        perror("Error creating tick thread");
+        close(serverSocket);
+        exit(EXIT_FAILURE);
+    }
 }
 
-void broadcastSnakes(int senderID, Snake* playerSnake) {
-    pthread_mutex_lock(&mutex);
+int buildSnakeMessage(int senderID, uint32_t tick, Snake* playerSnake, uint8_t *message) {
+    message[0] = MSG_SNAKE;
+    memcpy(message + 1, &startSignal, sizeof(int));
+    memcpy(message + 1 + sizeof(int), &senderID, sizeof(int));
+    putU32(message + 1 + 2 * sizeof(int), tick);
+    int size = 1 + 2 * sizeof(int) + 4;
+    return size + packSnake(playerSnake, message + size);
+}
+
+// Every snake in the match, the recipient skips its own. Called with mutex held.
+int buildKeyframe(uint32_t tick, uint8_t *message) {
+    int count = 0;
+    int size = KEYFRAME_HEADER_SIZE;
+
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        if (!world.present[p]) continue;
+        message[size++] = p + 1;
+        size += packSnake(&world.snakes[p], message + size);
+        count++;
+    }
+    message[0] = MSG_KEYFRAME;
+    putU32(message + 1, tick);
+    message[5] = count;
+    return size;
+}
+
+// Called with mutex held
+int buildFoodMessage(uint32_t tick, uint8_t *message) {
+    int size = FOOD_HEADER_SIZE;
+    for (int f = 0; f < world.foodCount; ++f) {
+        putU16(message + size, world.foodCells[f]);
+        size += 2;
+    }
+    message[0] = MSG_FOOD;
+    putU32(message + 1, tick);
+    message[5] = world.foodCount;
+    return size;
+}
+
+// One batch per recipient under its queue lock, so a writer never sends a tick's hash without that tick's snakes.
+// Runs without mutex, a queue that closed since the tick was built ignores the batch.
+void broadcastTick(TickBroadcast *broadcast) {
+    uint8_t hashMessage[HASH_MESSAGE_SIZE];
+    hashMessage[0] = MSG_HASH;
+    putU32(hashMessage + 1, broadcast->tick);
+
     for (int i = 0; i < MAX_CLIENTS; ++i) {
-        if (players[i].active && i != senderID - 1) {
-            send(players[i].clientSocket, &startSignal, sizeof(int), 0);
-            send(players[i].clientSocket, &senderID, sizeof(int), 0);
-            send(players[i].clientSocket, playerSnake, sizeof(Snake), 0);
+        if (!broadcast->recipient[i]) continue;
+        SendQueue *queue = &players[i].sendQueue;
+
+        pthread_mutex_lock(&queue->lock);
+        if (broadcast->wantsKeyframe[i]) {
+            pushMessage(queue, broadcast->keyframe, broadcast->keyframeSize, KEYFRAME_MESSAGE_KEY);
+        }
+        // Food and growth events are never replaced, the client applies every one of them in order
+        if (broadcast->foodChanged || broadcast->wantsFood[i]) {
+            pushMessage(queue, broadcast->food, broadcast->foodSize, 0);
+        }
+        if (broadcast->ate[i]) {
+            uint8_t grow[GROW_MESSAGE_SIZE];
+            grow[0] = MSG_GROW;
+            putU32(grow + 1, broadcast->tick);
+            grow[5] = 1;
+            pushMessage(queue, grow, sizeof(grow), 0);
         }
+        for (int p = 0; p < MAX_CLIENTS; ++p) {
+            // Each frame carries the whole snake, so an unsent older frame of the same sender is stale
+            if (broadcast->snakeSizes[p] > 0 && (broadcast->includeSender[p] || p != i)) {
+                pushMessage(queue, broadcast->snakeMessages[p], broadcast->snakeSizes[p], p + 1);
+            }
+        }
+        putU64(hashMessage + 5, broadcast->worldHash ^ broadcast->snakeHash[i]);
+        pushMessage(queue, hashMessage, sizeof(hashMessage), HASH_MESSAGE_KEY);
+        pthread_mutex_unlock(&queue->lock);
     }
-    pthread_mutex_unlock(&mutex);
+}
+
+// Drops replaced entries, swapping entries so every buffer stays owned by exactly one of them
+static void compactSendQueue(SendQueue *queue) {
+    int kept = 0;
+    for (int i = 0; i < queue->count; ++i) {
+        OutboundMessage *message = &queue->messages[(queue->head + i) % SEND_QUEUE_CAPACITY];
+        if (message->size == 0) continue;
+
+        OutboundMessage *target = &queue->messages[(queue->head + kept) % SEND_QUEUE_CAPACITY];
+        OutboundMessage swapped = *target;
+        *target = *message;
+        *message = swapped;
+        kept++;
+    }
+    queue->count = kept;
+}
+
+void enqueueMessage(SendQueue *queue, const uint8_t *data, int size, int key) {
+    pthread_mutex_lock(&queue->lock);
+    pushMessage(queue, data, size, key);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+// Called with the queue's lock held
+void pushMessage(SendQueue *queue, const uint8_t *data, int size, int key) {
+    if (queue->closed) return;
+
+    // Blank the stale message where it is, the newest one goes to the back so ordering with other messages is kept
+    for (int i = 0; key != 0 && i < queue->count; ++i) {
+        OutboundMessage *queued = &queue->messages[(queue->head + i) % SEND_QUEUE_CAPACITY];
+        if (queued->size > 0 && queued->key == key) {
+            queued->size = 0;
+            queue->droppedMessages++;
+            break;
+        }
+    }
+
+    // Queue is full: reclaim blanked entries, then drop the oldest replaceable message, or drop this one
+    if (queue->count == SEND_QUEUE_CAPACITY) compactSendQueue(queue);
+    if (queue->count == SEND_QUEUE_CAPACITY) {
+        OutboundMessage *oldest = NULL;
+        for (int i = 0; i < queue->count && oldest == NULL; ++i) {
+            OutboundMessage *queued = &queue->messages[(queue->head + i) % SEND_QUEUE_CAPACITY];
+            if (queued->key != 0) oldest = queued;
+        }
+        queue->droppedMessages++;
+        if (oldest == NULL) return;
+        oldest->size = 0;
+        compactSendQueue(queue);
+    }
+
+    OutboundMessage *message = &queue->messages[(queue->head + queue->count) % SEND_QUEUE_CAPACITY];
+    memcpy(message->data, data, size);
+    message->size = size;
+    message->key = key;
+    queue->count++;
+
+    pthread_cond_signal(&queue->ready);
+}
+
+void closeSendQueue(SendQueue *queue) {
+    pthread_mutex_lock(&queue->lock);
+    queue->closed = 1;
+    pthread_cond_signal(&queue->ready);
+    pthread_mutex_unlock(&queue->lock);
+}
+
+void *writerHandler(void *arg) {
+    PlayerData *player = (PlayerData *)arg;
+    SendQueue *queue = &player->sendQueue;
+    uint8_t data[MAX_MESSAGE_SIZE];
+
+    while (1) {
+        pthread_mutex_lock(&queue->lock);
+        while (queue->count == 0 && !queue->closed) {
+            pthread_cond_wait(&queue->ready, &queue->lock);
+        }
+        if (queue->closed) {
+            pthread_mutex_unlock(&queue->lock);
+            break;
+        }
+        OutboundMessage *message = &queue->messages[queue->head];
+        int size = message->size;
+        memcpy(data, message->data, size);
+        queue->head = (queue->head + 1) % SEND_QUEUE_CAPACITY;
+        queue->count--;
+        pthread_mutex_unlock(&queue->lock);
+        if (size == 0) continue;
+
+        if (data[0] == MSG_PONG) putU64(data + 17, serverClock());
+
+        // Only this thread writes to the socket after the join handshake
+        if (sendAll(player->clientSocket, data, size) == -1) {
+            closeSendQueue(queue);
+            break;
+        }
+    }
+    return NULL;
+}
+
+void openReplay(const char *path) {
+    replayFile = fopen(path, "wb");
+    if (replayFile == NULL) {
+        perror("Error opening replay file");
+        exit(EXIT_FAILURE);
+    }
+    fwrite(REPLAY_MAGIC, 1, 4, replayFile);
+    replayStart = monotonicMicros();
+}
+
+// Replay record layout is in protocol.h, replay-reader reads it back
+void recordReplayFrame(int playerID, Snake* playerSnake) {
+    if (replayFile == NULL) return;
+
+    uint8_t record[REPLAY_RECORD_HEADER_SIZE + SNAKE_CODEC_MAX_SIZE];
+    uint32_t elapsed = (monotonicMicros() - replayStart) / 1000;
+    int size = encodeSnake(playerSnake, record + REPLAY_RECORD_HEADER_SIZE);
+    putU32(record, elapsed);
+    record[4] = playerID;
+    putU16(record + 5, size);
+
+    pthread_mutex_lock(&replayMutex);
+    if (replayFile != NULL) fwrite(record, 1, REPLAY_RECORD_HEADER_SIZE + size, replayFile);
+    pthread_mutex_unlock(&replayMutex);
+}
+
+// Network players and local agents share the same player IDs. Only an ID a local agent leaves is
+// ever handed out again
+int claimPlayerSlot() {
+    if (localTransportName != NULL) return shmClaimSlot(&localTransport, SLOT_NETWORK, NULL);
+    return nextPlayerID < MAX_CLIENTS ? nextPlayerID++ : -1;
+}
+
+// Runs on the tick thread: admits agents that claimed a slot, drops ones that stopped reading frames,
+// frees the slots they left and queues their snake updates like a client's
+void serviceLocalAgents(uint32_t tick) {
+    if (localTransportName == NULL) return;
+
+    for (int playerID = 1; playerID < MAX_CLIENTS; ++playerID) {
+        PlayerData *player = &players[playerID - 1];
+        int state = shmSlotState(&localTransport, playerID);
+        uint32_t claim = shmSlotClaim(&localTransport, playerID);
+
+        // A crashed or killed agent never marks its slot as left
+        if (state == SLOT_LOCAL_ACTIVE && tick - shmLastHeartbeat(&localTransport, playerID) > HEARTBEAT_TIMEOUT_TICKS &&
+            shmChangeSlotState(&localTransport, playerID, claim, SLOT_LOCAL_ACTIVE, SLOT_LOCAL_LEFT) == 0) {
+            printf("Player %d timed out.\n", playerID);
+            state = SLOT_LOCAL_LEFT;
+        }
+
+        if (state == SLOT_LOCAL_PENDING) {
+            PlayerInfo playerInfo = { -1, playerID };
+            Snake playerSnake;
+            Movement startingPosition;
+            initPlayer(&playerInfo, &playerSnake, &startingPosition);
+
+            // Agents follow the world frames, nothing is ever sent to them over a socket
+            closeSendQueue(&player->sendQueue);
+
+            pthread_mutex_lock(&mutex);
+            player->clientSocket = -1;
+            player->playerID = playerID;
+            player->playerSnake = playerSnake;
+            player->playerMovement = startingPosition;
+            player->active = 1;
+            player->deathFlag = 0;
+            player->inputs.count = 0;
+            player->keyframeRequested = 0;
+            player->foodRequested = 1;
+            memset(&player->stats, 0, sizeof(ConnectionStats));
+            pthread_mutex_unlock(&mutex);
+
+            // An agent that quit before this tick is dropped on the next one
+            shmHeartbeat(&localTransport, playerID, tick);
+            shmChangeSlotState(&localTransport, playerID, claim, SLOT_LOCAL_PENDING, SLOT_LOCAL_ACTIVE);
+            requestGameStatus();
+        } else if (state == SLOT_LOCAL_LEFT && player->active) {
+            printf("Player %d disconnected.\n", playerID);
+            pthread_mutex_lock(&mutex);
+            player->active = 0;
+            pthread_mutex_unlock(&mutex);
+        } else if (state == SLOT_LOCAL_LEFT && !world.present[playerID - 1]) {
+            // The last tick's step took the snake's cells off the grid and told the clients it left
+            shmChangeSlotState(&localTransport, playerID, claim, SLOT_LOCAL_LEFT, SLOT_FREE);
+        }
+    }
+
+    // Bounded so agents flooding the ring cannot hold up the tick
+    uint8_t message[MAX_MESSAGE_SIZE];
+    uint32_t size;
+    int ownerID;
+    uint32_t ownerClaim;
+    int headerSize = 1 + sizeof(int) + 12;
+    for (int taken = 0; taken < INPUT_RING_SLOTS && shmTakeInput(&localTransport, &ownerID, &ownerClaim, message, &size) == 0; ++taken) {
+        if (size < (uint32_t)headerSize || message[0] != MSG_SNAKE) continue;
+
+        // Only the agent holding the slot right now may move its snake, not one that timed out of it
+        int senderID;
+        Snake receivedSnake;
+        memcpy(&senderID, message + 1, sizeof(int));
+        if (senderID < 1 || senderID >= MAX_CLIENTS || senderID != ownerID) continue;
+        if (shmSlotState(&localTransport, senderID) != SLOT_LOCAL_ACTIVE || shmSlotClaim(&localTransport, senderID) != ownerClaim) continue;
+        if (unpackSnake(message + headerSize, size - headerSize, &receivedSnake) == -1) continue;
+
+        queueInput(senderID, &receivedSnake, getU32(message + 1 + sizeof(int)), getU64(message + 5 + sizeof(int)));
+    }
+}
+
+// Every snake in the match, so a reader can start from any frame. Called with mutex held.
+int buildWorldFrame(uint32_t tick, uint8_t *frame) {
+    int count = 0;
+    int size = WORLD_FRAME_HEADER_SIZE;
+
+    for (int p = 0; p < MAX_CLIENTS; ++p) {
+        if (!world.present[p]) continue;
+        frame[size++] = p + 1;
+        frame[size++] = world.growth[p] < 255 ? world.growth[p] : 255;
+        size += packSnake(&world.snakes[p], frame + size);
+        count++;
+    }
+    frame[size++] = world.foodCount;
+    for (int f = 0; f < world.foodCount; ++f) {
+        putU16(frame + size, world.foodCells[f]);
+        size += 2;
+    }
+    putU32(frame, tick);
+    putU64(frame + 4, serverClock());
+    putU64(frame + 12, world.hash);
+    frame[20] = startSignal;
+    frame[21] = count;
+    return size;
 }
 
 // Temporary Functions //
+// Called from the tick thread, which must not wait for printGameStatus() to fork and clear the screen
+void requestGameStatus() {
+    pthread_mutex_lock(&statusMutex);
+    statusRequested = 1;
+    pthread_cond_signal(&statusReady);
+    pthread_mutex_unlock(&statusMutex);
+}
+
+// Requests made while the dashboard is being printed are folded into one more print
+void *statusHandler(void *arg) {
+    while (1) {
+        pthread_mutex_lock(&statusMutex);
+        while (!statusRequested) pthread_cond_wait(&statusReady, &statusMutex);
+        statusRequested = 0;
+        pthread_mutex_unlock(&statusMutex);
+
+        printGameStatus();
+    }
+    return NULL;
+}
+
 void printGameStatus(){
     int playersAlive = 0;
     for(int i = 0; i < 3; i++){ if(players[i].playerSnake.isAlive) playersAlive++; }
@@ -339,6 +982,7 @@ void printGameStatus(){
     printf("+---------------------------------+\n");
     printf("| type start to Start the Game!   |\n");
     printf("| type quit to Quit the Server!   |\n");
+    printf("| type stats to Show Net Stats!   |\n");
     printf("+---------------------------------+\n");
     printf("| Player 1: %s         |\n", checkStatus(players[0], playersAlive));
     printf("| Player 2: %s         |\n", checkStatus(players[1], playersAlive));
@@ -347,6 +991,22 @@ void printGameStatus(){
     printf("+---------------------------------+\n");
 }
 
+void printNetworkStats(){
+    pthread_mutex_lock(&mutex);
+    printf("+--------+----------+----------+------------+--------+---------+-----------+\n");
+    printf("| Player | RTT (ms) | Jitter   | Input (ms) | Late   | Dropped | Keyframes |\n");
+    printf("+--------+----------+----------+------------+--------+---------+-----------+\n");
+    for(int i = 0; i < MAX_CLIENTS - 1; i++){
+        if(!players[i].active) continue;
+        ConnectionStats stats = players[i].stats;
+        printf("| %6d | %8.1f | %8.1f | %10.1f | %6d | %7d | %9d |\n", i + 1,
+            stats.smoothedRTT / 1000.0, stats.rttJitter / 1000.0, stats.inputLatency / 1000.0,
+            stats.lateInputs, players[i].sendQueue.droppedMessages, stats.keyframes);
+    }
+    printf("+--------+----------+----------+------------+--------+---------+-----------+\n");
+    pthread_mutex_unlock(&mutex);
+}
+
 char* checkStatus(PlayerData currentPlayer, int playersAlive){
     if(!currentPlayer.active){
         return "Connecting...";
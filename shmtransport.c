@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shmtransport.h"
+
+#define SHM_MAGIC 0x534E4B31 // "SNK1"
+#define SLOT_STATE_BITS 8 // A slot word is claim << SLOT_STATE_BITS | state, so both change in one CAS
+
+// Seqlock slot: the sequence is odd while the server writes it and 2 * (frame + 1) once frame is complete
+typedef struct {
+    _Atomic uint64_t sequence;
+    _Atomic uint32_t size;
+    uint8_t data[WORLD_FRAME_MAX_SIZE];
+} FrameSlot;
+
+// Bounded multi-producer queue slot: sequence == position when free, position + 1 once filled
+typedef struct {
+    _Atomic uint64_t sequence;
+    int playerID;
+    uint32_t claim;
+    uint32_t size;
+    uint8_t data[SNAKE_MESSAGE_MAX_SIZE];
+} InputSlot;
+
+struct SharedRegion {
+    uint32_t magic;
+    uint32_t slotCount;
+    uint64_t serverStart; // monotonicMicros() of the server's clock origin, valid across processes
+    _Atomic uint32_t slots[MAX_CLIENTS - 1];
+    _Atomic uint32_t heartbeats[MAX_CLIENTS - 1];
+
+    _Atomic uint64_t framesPublished __attribute__((aligned(64)));
+    FrameSlot frames[FRAME_RING_SLOTS];
+
+    _Atomic uint64_t inputHead __attribute__((aligned(64))); // Next position agents reserve
+    _Atomic uint64_t inputTail __attribute__((aligned(64))); // Next position the server takes
+    InputSlot inputs[INPUT_RING_SLOTS];
+};
+
+static int mapRegion(SharedTransport *transport, int fd) {
+    transport->size = sizeof(SharedRegion);
+    transport->region = mmap(NULL, transport->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (transport->region == MAP_FAILED) {
+        transport->region = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int shmCreate(SharedTransport *transport, const char *name, uint64_t serverStart) {
+    memset(transport, 0, sizeof(SharedTransport));
+    snprintf(transport->name, sizeof(transport->name), "%s", name);
+
+    // A region left behind by a crashed server would carry stale claims and frames
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) return -1;
+    if (ftruncate(fd, sizeof(SharedRegion)) == -1 || mapRegion(transport, fd) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+    transport->owner = 1;
+
+    SharedRegion *region = transport->region;
+    region->slotCount = MAX_CLIENTS - 1;
+    region->serverStart = serverStart;
+    for (int i = 0; i < INPUT_RING_SLOTS; ++i) atomic_init(&region->inputs[i].sequence, i);
+    atomic_thread_fence(memory_order_release);
+    region->magic = SHM_MAGIC;
+    return 0;
+}
+
+int shmAttach(SharedTransport *transport, const char *name) {
+    memset(transport, 0, sizeof(SharedTransport));
+    snprintf(transport->name, sizeof(transport->name), "%s", name);
+
+    int fd = shm_open(name, O_RDWR, 0600);
+    if (fd == -1) return -1;
+    struct stat info;
+    if (fstat(fd, &info) == -1 || (size_t)info.st_size < sizeof(SharedRegion)) {
+        close(fd);
+        return -1;
+    }
+    if (mapRegion(transport, fd) == -1) return -1;
+
+    if (transport->region->magic != SHM_MAGIC || transport->region->slotCount != MAX_CLIENTS - 1) {
+        shmDetach(transport);
+        return -1;
+    }
+    return 0;
+}
+
+void shmDetach(SharedTransport *transport) {
+    if (transport->region != NULL) munmap(transport->region, transport->size);
+    if (transport->owner) shm_unlink(transport->name);
+    transport->region = NULL;
+}
+
+uint64_t shmServerStart(SharedTransport *transport) {
+    return transport->region->serverStart;
+}
+
+void shmPublishFrame(SharedTransport *transport, const uint8_t *data, uint32_t size) {
+    SharedRegion *region = transport->region;
+    if (size > WORLD_FRAME_MAX_SIZE) return;
+
+    uint64_t frame = atomic_load_explicit(&region->framesPublished, memory_order_relaxed);
+    FrameSlot *slot = &region->frames[frame % FRAME_RING_SLOTS];
+
+    atomic_store_explicit(&slot->sequence, 2 * frame + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(slot->data, data, size);
+    atomic_store_explicit(&slot->size, size, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, 2 * frame + 2, memory_order_release);
+    atomic_store_explicit(&region->framesPublished, frame + 1, memory_order_release);
+}
+
+void shmInitReader(FrameReader *reader, SharedTransport *transport) {
+    reader->transport = transport;
+    reader->skippedFrames = 0;
+    reader->expectedSequence = 0;
+
+    uint64_t published = atomic_load_explicit(&transport->region->framesPublished, memory_order_acquire);
+    reader->nextFrame = published > 0 ? published - 1 : 0;
+}
+
+const uint8_t *shmBeginRead(FrameReader *reader, uint32_t *size) {
+    SharedRegion *region = reader->transport->region;
+    uint64_t published = atomic_load_explicit(&region->framesPublished, memory_order_acquire);
+    if (reader->nextFrame >= published) return NULL;
+
+    // Lapped by the server: older frames are gone, continue from the newest one
+    if (published - reader->nextFrame > FRAME_RING_SLOTS - 1) {
+        reader->skippedFrames += published - 1 - reader->nextFrame;
+        reader->nextFrame = published - 1;
+    }
+
+    FrameSlot *slot = &region->frames[reader->nextFrame % FRAME_RING_SLOTS];
+    reader->expectedSequence = 2 * reader->nextFrame + 2;
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != reader->expectedSequence) {
+        reader->skippedFrames++;
+        reader->nextFrame++;
+        return NULL;
+    }
+
+    uint32_t frameSize = atomic_load_explicit(&slot->size, memory_order_relaxed);
+    *size = frameSize <= WORLD_FRAME_MAX_SIZE ? frameSize : WORLD_FRAME_MAX_SIZE;
+    return slot->data;
+}
+
+int shmEndRead(FrameReader *reader) {
+    SharedRegion *region = reader->transport->region;
+    FrameSlot *slot = &region->frames[reader->nextFrame % FRAME_RING_SLOTS];
+
+    atomic_thread_fence(memory_order_acquire);
+    int intact = atomic_load_explicit(&slot->sequence, memory_order_relaxed) == reader->expectedSequence;
+    if (!intact) reader->skippedFrames++;
+    reader->nextFrame++;
+    return intact;
+}
+
+int shmSubmitInput(SharedTransport *transport, int playerID, uint32_t claim, const uint8_t *data, uint32_t size) {
+    SharedRegion *region = transport->region;
+    if (size > SNAKE_MESSAGE_MAX_SIZE) return -1;
+
+    uint64_t position = atomic_load_explicit(&region->inputHead, memory_order_relaxed);
+    while (1) {
+        InputSlot *slot = &region->inputs[position % INPUT_RING_SLOTS];
+        uint64_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        int64_t difference = (int64_t)sequence - (int64_t)position;
+
+        if (difference == 0) {
+            if (atomic_compare_exchange_weak_explicit(&region->inputHead, &position, position + 1,
+                    memory_order_relaxed, memory_order_relaxed)) {
+                memcpy(slot->data, data, size);
+                slot->playerID = playerID;
+                slot->claim = claim;
+                slot->size = size;
+                atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+                return 0;
+            }
+        } else if (difference < 0) {
+            return -1;
+        } else {
+            position = atomic_load_explicit(&region->inputHead, memory_order_relaxed);
+        }
+    }
+}
+
+int shmTakeInput(SharedTransport *transport, int *playerID, uint32_t *claim, uint8_t *data, uint32_t *size) {
+    SharedRegion *region = transport->region;
+    uint64_t position = atomic_load_explicit(&region->inputTail, memory_order_relaxed);
+    InputSlot *slot = &region->inputs[position % INPUT_RING_SLOTS];
+
+    if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != position + 1) return -1;
+
+    *size = slot->size <= SNAKE_MESSAGE_MAX_SIZE ? slot->size : SNAKE_MESSAGE_MAX_SIZE;
+    memcpy(data, slot->data, *size);
+    *playerID = slot->playerID;
+    *claim = slot->claim;
+    atomic_store_explicit(&slot->sequence, position + INPUT_RING_SLOTS, memory_order_release);
+    atomic_store_explicit(&region->inputTail, position + 1, memory_order_relaxed);
+    return 0;
+}
+
+int shmClaimSlot(SharedTransport *transport, int state, uint32_t *claim) {
+    for (int i = 0; i < MAX_CLIENTS - 1; ++i) {
+        uint32_t word = atomic_load(&transport->region->slots[i]);
+        while ((word & ((1u << SLOT_STATE_BITS) - 1)) == SLOT_FREE) {
+            uint32_t next = (word >> SLOT_STATE_BITS) + 1;
+            if (atomic_compare_exchange_weak(&transport->region->slots[i], &word, next << SLOT_STATE_BITS | state)) {
+                if (claim != NULL) *claim = next;
+                return i + 1;
+            }
+        }
+    }
+    return -1;
+}
+
+int shmSlotState(SharedTransport *transport, int playerID) {
+    return atomic_load(&transport->region->slots[playerID - 1]) & ((1u << SLOT_STATE_BITS) - 1);
+}
+
+uint32_t shmSlotClaim(SharedTransport *transport, int playerID) {
+    return atomic_load(&transport->region->slots[playerID - 1]) >> SLOT_STATE_BITS;
+}
+
+int shmChangeSlotState(SharedTransport *transport, int playerID, uint32_t claim, int from, int to) {
+    uint32_t expected = claim << SLOT_STATE_BITS | from;
+    uint32_t next = claim << SLOT_STATE_BITS | to;
+    return atomic_compare_exchange_strong(&transport->region->slots[playerID - 1], &expected, next) ? 0 : -1;
+}
+
+void shmHeartbeat(SharedTransport *transport, int playerID, uint32_t tick) {
+    atomic_store_explicit(&transport->region->heartbeats[playerID - 1], tick, memory_order_relaxed);
+}
+
+uint32_t shmLastHeartbeat(SharedTransport *transport, int playerID) {
+    return atomic_load_explicit(&transport->region->heartbeats[playerID - 1], memory_order_relaxed);
+}
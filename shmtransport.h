@@ -0,0 +1,86 @@
+#ifndef SHMTRANSPORT_H
+#define SHMTRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "protocol.h"
+
+// Shared-memory transport for bots, recorders and spectators running on the server's host.
+// The server publishes one world frame per tick into a ring that any number of local readers
+// follow without copying or making system calls, and takes snake updates back from a lock-free
+// input ring that any number of local agents can write to.
+//
+// World frame: [u32 tick][u64 publishTime][u64 worldHash][u8 startSignal][u8 count]
+//   then count x [u8 playerID][u8 growth][packed snake], then [u8 foodCount] and foodCount x [u16 cell]
+// growth is how many segments the snake may still grow by, see MSG_GROW.
+// publishTime is on the server clock, which agents get from shmServerStart(). worldHash covers
+// every snake, see hashSnake().
+// Input: the same bytes as a client's MSG_SNAKE message, stamped with the submitting agent's claim
+
+#define SHM_DEFAULT_NAME "/snake-game"
+#define FRAME_RING_SLOTS 64
+#define INPUT_RING_SLOTS 256
+#define WORLD_FRAME_HEADER_SIZE 22
+#define WORLD_FRAME_MAX_SIZE (WORLD_FRAME_HEADER_SIZE + MAX_CLIENTS * (2 + PACKED_SNAKE_MAX_SIZE) + 1 + FOOD_COUNT * 2)
+
+// Player slot states, shared by network players and local agents so both draw from the same IDs
+#define SLOT_FREE 0
+#define SLOT_NETWORK 1
+#define SLOT_LOCAL_PENDING 2 // Claimed by an agent, the server activates it on its next tick
+#define SLOT_LOCAL_ACTIVE 3
+#define SLOT_LOCAL_LEFT 4 // The server frees it once the agent's snake is out of the world
+
+// An active agent that stamps no heartbeat for this many ticks is taken out of the match
+#define HEARTBEAT_TIMEOUT_TICKS 40
+
+typedef struct SharedRegion SharedRegion;
+
+typedef struct {
+    SharedRegion *region;
+    size_t size;
+    int owner;
+    char name[64];
+} SharedTransport;
+
+typedef struct {
+    SharedTransport *transport;
+    uint64_t nextFrame;
+    uint64_t expectedSequence;
+    uint64_t skippedFrames; // Overwritten before this reader got to them
+} FrameReader;
+
+int shmCreate(SharedTransport *transport, const char *name, uint64_t serverStart);
+int shmAttach(SharedTransport *transport, const char *name);
+void shmDetach(SharedTransport *transport);
+uint64_t shmServerStart(SharedTransport *transport);
+
+// Server -> local readers. Only the server's tick thread may publish.
+void shmPublishFrame(SharedTransport *transport, const uint8_t *data, uint32_t size);
+
+// Returns a pointer to the next frame inside shared memory, or NULL if there is no new frame.
+// The frame is read in place: call shmEndRead() afterwards, it returns 0 if the server
+// overwrote the slot while it was being read and the data must be thrown away.
+void shmInitReader(FrameReader *reader, SharedTransport *transport);
+const uint8_t *shmBeginRead(FrameReader *reader, uint32_t *size);
+int shmEndRead(FrameReader *reader);
+
+// Local agents -> server. Submitting returns -1 when the ring is full, taking returns -1 when it is empty.
+// Every input carries the player ID and claim it was submitted under, see shmClaimSlot().
+int shmSubmitInput(SharedTransport *transport, int playerID, uint32_t claim, const uint8_t *data, uint32_t size);
+int shmTakeInput(SharedTransport *transport, int *playerID, uint32_t *claim, uint8_t *data, uint32_t *size);
+
+// Claims the lowest free player ID in the given state, or returns -1 if the match is full.
+// A freed ID can be claimed again, each claim gets a new number so a stale owner can tell it lost the slot.
+int shmClaimSlot(SharedTransport *transport, int state, uint32_t *claim);
+int shmSlotState(SharedTransport *transport, int playerID);
+uint32_t shmSlotClaim(SharedTransport *transport, int playerID);
+
+// Moves the slot from one state to another, returns -1 if it is no longer in that state under that claim
+int shmChangeSlotState(SharedTransport *transport, int playerID, uint32_t claim, int from, int to);
+
+// Agents stamp the tick of the last frame they read, so the server notices one that crashed
+void shmHeartbeat(SharedTransport *transport, int playerID, uint32_t tick);
+uint32_t shmLastHeartbeat(SharedTransport *transport, int playerID);
+
+#endif
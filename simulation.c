@@ -0,0 +1,304 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulation.h"
+
+#define MOVE_NONE 0
+#define MOVE_SHIFT 1 // Head advanced one cell, every segment followed, the tail cell was freed
+#define MOVE_GROW 2 // Head advanced one cell and the tail stayed
+#define MOVE_REPLACE 3 // Anything else, the whole snake is re-added
+
+typedef struct {
+    World *world;
+    const Snake *updates;
+    const int *hasUpdate;
+    const int *present;
+} StepContext;
+
+int initWorld(World *world, int snakeCount, uint64_t seed) {
+    memset(world, 0, sizeof(World));
+    world->snakeCount = snakeCount;
+    world->snakes = calloc(snakeCount, sizeof(Snake));
+    world->present = calloc(snakeCount, sizeof(int));
+    world->inGrid = calloc(snakeCount, sizeof(int));
+    world->occupancy = calloc(GRID_CELLS, sizeof(uint16_t));
+    world->snakeHash = calloc(snakeCount, sizeof(uint64_t));
+    world->freeCells = calloc(GRID_CELLS, sizeof(int));
+    world->freeSlot = calloc(GRID_CELLS, sizeof(int));
+    world->food = calloc(GRID_CELLS, sizeof(uint8_t));
+    world->growth = calloc(snakeCount, sizeof(int));
+    world->ate = calloc(snakeCount, sizeof(int));
+    world->next = calloc(snakeCount, sizeof(Snake));
+    world->moveKind = calloc(snakeCount, sizeof(int));
+    world->outOfBounds = calloc(snakeCount, sizeof(int));
+    world->collided = calloc(snakeCount, sizeof(int));
+
+    if (!world->snakes || !world->present || !world->inGrid || !world->occupancy || !world->snakeHash ||
+        !world->freeCells || !world->freeSlot || !world->food || !world->growth || !world->ate ||
+        !world->next || !world->moveKind || !world->outOfBounds || !world->collided) {
+        freeWorld(world);
+        return -1;
+    }
+
+    for (int cell = 0; cell < GRID_CELLS; ++cell) {
+        world->freeCells[cell] = cell;
+        world->freeSlot[cell] = cell;
+    }
+    world->freeCount = GRID_CELLS;
+    world->randomState = seed != 0 ? seed : 1;
+    return 0;
+}
+
+void freeWorld(World *world) {
+    free(world->snakes);
+    free(world->present);
+    free(world->inGrid);
+    free(world->occupancy);
+    free(world->snakeHash);
+    free(world->freeCells);
+    free(world->freeSlot);
+    free(world->food);
+    free(world->growth);
+    free(world->ate);
+    free(world->next);
+    free(world->moveKind);
+    free(world->outOfBounds);
+    free(world->collided);
+    memset(world, 0, sizeof(World));
+}
+
+static int sameSegment(SnakeSegment a, SnakeSegment b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static int sameSnake(const Snake *a, const Snake *b) {
+    if (a->isAlive != b->isAlive || a->body_length != b->body_length || !sameSegment(a->head, b->head)) return 0;
+    for (int i = 0; i < a->body_length; ++i) {
+        if (!sameSegment(a->body[i], b->body[i])) return 0;
+    }
+    return 1;
+}
+
+static int classifyMove(const Snake *previous, const Snake *next) {
+    if (previous->body_length < 1 || next->body_length < 1) return MOVE_REPLACE;
+    if (next->body_length != previous->body_length && next->body_length != previous->body_length + 1) return MOVE_REPLACE;
+    if (!sameSegment(next->body[0], previous->head)) return MOVE_REPLACE;
+
+    for (int i = 1; i < next->body_length; ++i) {
+        if (!sameSegment(next->body[i], previous->body[i - 1])) return MOVE_REPLACE;
+    }
+    return next->body_length == previous->body_length ? MOVE_SHIFT : MOVE_GROW;
+}
+
+static void takeFreeCell(World *world, int cell) {
+    int slot = world->freeSlot[cell];
+    if (slot < 0) return;
+
+    int last = world->freeCells[--world->freeCount];
+    world->freeCells[slot] = last;
+    world->freeSlot[last] = slot;
+    world->freeSlot[cell] = -1;
+}
+
+static void addFreeCell(World *world, int cell) {
+    if (world->freeSlot[cell] >= 0) return;
+
+    world->freeSlot[cell] = world->freeCount;
+    world->freeCells[world->freeCount++] = cell;
+}
+
+// xorshift64*, the tick thread is the only caller
+static uint64_t nextRandom(World *world) {
+    world->randomState ^= world->randomState >> 12;
+    world->randomState ^= world->randomState << 25;
+    world->randomState ^= world->randomState >> 27;
+    return world->randomState * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, bound): multiply-shift on the high 32 bits, redrawing the few products that would
+// make some results more likely than others
+static uint32_t randomBelow(World *world, uint32_t bound) {
+    uint64_t product = (nextRandom(world) >> 32) * bound;
+    if ((uint32_t)product < bound) {
+        uint32_t threshold = -bound % bound;
+        while ((uint32_t)product < threshold) product = (nextRandom(world) >> 32) * bound;
+    }
+    return product >> 32;
+}
+
+// Snake i belongs to player i + 1, whose Zobrist keys it adds to the hash
+static void occupyCell(World *world, int index, SnakeSegment segment) {
+    int cell = cellIndex(segment);
+    if (cell < 0) return;
+
+    uint64_t key = zobristKey(index + 1, segment);
+    if (world->occupancy[cell]++ == 0) takeFreeCell(world, cell);
+    world->snakeHash[index] ^= key;
+    world->hash ^= key;
+}
+
+static void releaseCell(World *world, int index, SnakeSegment segment) {
+    int cell = cellIndex(segment);
+    if (cell < 0 || world->occupancy[cell] == 0) return;
+
+    uint64_t key = zobristKey(index + 1, segment);
+    if (--world->occupancy[cell] == 0 && !world->food[cell]) addFreeCell(world, cell);
+    world->snakeHash[index] ^= key;
+    world->hash ^= key;
+}
+
+static void occupySnake(World *world, int index, const Snake *snake) {
+    occupyCell(world, index, snake->head);
+    for (int i = 0; i < snake->body_length; ++i) occupyCell(world, index, snake->body[i]);
+}
+
+static void releaseSnake(World *world, int index, const Snake *snake) {
+    releaseCell(world, index, snake->head);
+    for (int i = 0; i < snake->body_length; ++i) releaseCell(world, index, snake->body[i]);
+}
+
+// Phase 1: proposed state and move classification
+static void advanceSnakes(void *arg, int begin, int end) {
+    StepContext *context = (StepContext *)arg;
+    World *world = context->world;
+
+    for (int i = begin; i < end; ++i) {
+        const Snake *previous = &world->snakes[i];
+        Snake *next = &world->next[i];
+        int accept = context->present[i] && context->hasUpdate[i] && (!world->present[i] || previous->isAlive);
+
+        *next = accept ? context->updates[i] : *previous;
+        if (next->body_length < 0) next->body_length = 0;
+        if (next->body_length > MAX_SNAKE_LENGTH - 1) next->body_length = MAX_SNAKE_LENGTH - 1;
+
+        // Growth is paid for with food, a joining snake keeps its starting length
+        if (accept && world->present[i]) {
+            int allowed = previous->body_length + world->growth[i];
+            if (next->body_length > allowed) next->body_length = allowed;
+            if (next->body_length > previous->body_length) world->growth[i] -= next->body_length - previous->body_length;
+        } else if (accept) {
+            world->growth[i] = 0;
+        }
+
+        world->moveKind[i] = accept ? classifyMove(previous, next) : MOVE_NONE;
+        world->outOfBounds[i] = next->isAlive &&
+            (next->head.x < MIN_X || next->head.x > MAX_X || next->head.y < MIN_Y || next->head.y > MAX_Y);
+    }
+}
+
+// Phase 3: a live head shares its cell with another segment, its own body included
+static void queryCollisions(void *arg, int begin, int end) {
+    StepContext *context = (StepContext *)arg;
+    World *world = context->world;
+
+    for (int i = begin; i < end; ++i) {
+        const Snake *snake = &world->snakes[i];
+        world->collided[i] = 0;
+        if (!context->present[i] || !snake->isAlive) continue;
+
+        int cell = cellIndex(snake->head);
+        world->collided[i] = world->outOfBounds[i] || (cell >= 0 && world->occupancy[cell] > 1);
+    }
+}
+
+void stepWorld(World *world, const Snake *updates, const int *hasUpdate, const int *present, int *killed, WorkPool *pool) {
+    StepContext context = { world, updates, hasUpdate, present };
+
+    runParallel(pool, world->snakeCount, SIMULATION_GRAIN, advanceSnakes, &context);
+
+    // Phase 2: grid updates
+    for (int i = 0; i < world->snakeCount; ++i) {
+        Snake *previous = &world->snakes[i];
+        Snake *next = &world->next[i];
+
+        if (world->inGrid[i] && (!present[i] || !next->isAlive)) {
+            releaseSnake(world, i, previous);
+            world->inGrid[i] = 0;
+        } else if (present[i] && next->isAlive && !world->inGrid[i]) {
+            occupySnake(world, i, next);
+            world->inGrid[i] = 1;
+        } else if (world->inGrid[i]) {
+            switch (world->moveKind[i]) {
+                case MOVE_SHIFT:
+                    occupyCell(world, i, next->head);
+                    releaseCell(world, i, previous->body[previous->body_length - 1]);
+                    break;
+                case MOVE_GROW:
+                    occupyCell(world, i, next->head);
+                    break;
+                case MOVE_REPLACE:
+                    releaseSnake(world, i, previous);
+                    occupySnake(world, i, next);
+                    break;
+            }
+        }
+
+        *previous = *next;
+        world->present[i] = present[i];
+    }
+
+    runParallel(pool, world->snakeCount, SIMULATION_GRAIN, queryCollisions, &context);
+
+    // Phase 4: every decision above was made on the same grid, so removal order cannot change the outcome
+    for (int i = 0; i < world->snakeCount; ++i) {
+        killed[i] = world->collided[i];
+        if (!killed[i]) continue;
+
+        world->snakes[i].isAlive = 0;
+        if (world->inGrid[i]) {
+            releaseSnake(world, i, &world->snakes[i]);
+            world->inGrid[i] = 0;
+        }
+    }
+
+    world->foodChanged = 0;
+    for (int i = 0; i < world->snakeCount; ++i) {
+        world->ate[i] = 0;
+        if (!world->inGrid[i]) continue;
+
+        // The head's cell is occupied, so eating does not make it free
+        int cell = cellIndex(world->snakes[i].head);
+        if (cell < 0 || !world->food[cell]) continue;
+        world->food[cell] = 0;
+        for (int f = 0; f < world->foodCount; ++f) {
+            if (world->foodCells[f] == cell) world->foodCells[f] = world->foodCells[--world->foodCount];
+        }
+        world->growth[i]++;
+        world->ate[i] = 1;
+        world->foodChanged = 1;
+    }
+
+    // Uniform over the free cells however full the board is
+    while (world->foodCount < FOOD_COUNT && world->freeCount > 0) {
+        int cell = world->freeCells[randomBelow(world, world->freeCount)];
+        takeFreeCell(world, cell);
+        world->food[cell] = 1;
+        world->foodCells[world->foodCount++] = cell;
+        world->foodChanged = 1;
+    }
+}
+
+void insertInput(InputBuffer *buffer, const PendingInput *input) {
+    if (buffer->count == INPUT_BUFFER_SIZE) {
+        memmove(&buffer->inputs[0], &buffer->inputs[1], (INPUT_BUFFER_SIZE - 1) * sizeof(PendingInput));
+        buffer->count--;
+    }
+
+    int position = buffer->count;
+    while (position > 0 && buffer->inputs[position - 1].targetTick > input->targetTick) position--;
+
+    // Clients resend an unchanged snake every frame, a copy would only hold later moves back a tick
+    if (position > 0 && sameSnake(&buffer->inputs[position - 1].snake, &input->snake)) return;
+    memmove(&buffer->inputs[position + 1], &buffer->inputs[position], (buffer->count - position) * sizeof(PendingInput));
+    buffer->inputs[position] = *input;
+    buffer->count++;
+}
+
+int takeDueInput(InputBuffer *buffer, uint32_t tick, PendingInput *input) {
+    if (buffer->count == 0 || buffer->inputs[0].targetTick > tick) return 0;
+
+    *input = buffer->inputs[0];
+    buffer->count--;
+    memmove(&buffer->inputs[0], &buffer->inputs[1], buffer->count * sizeof(PendingInput));
+    return 1;
+}
@@ -0,0 +1,82 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "protocol.h"
+#include "workpool.h"
+
+#define SIMULATION_GRAIN 16 // Snakes per parallel chunk, smaller matches run on the tick thread alone
+
+// Server-side view of the match, advanced once per tick by stepWorld().
+// Collision checks use an occupancy grid that is kept up to date incrementally: a snake that moved
+// one cell only adds its new head and removes its old tail.
+typedef struct {
+    int snakeCount;
+    Snake *snakes; // Committed state after the last step
+    int *present; // Snake takes part in the match (its player is connected)
+    int *inGrid; // Snake's cells are counted in occupancy
+    uint16_t *occupancy; // Live segments on each grid cell
+    uint64_t *snakeHash; // Zobrist hash of each snake's counted cells, see hashSnake()
+    uint64_t hash; // XOR of every snakeHash, updated with the occupancy grid
+
+    // Free-cell index, kept in the same updates as occupancy: a cell is free when no segment and no
+    // food is on it. freeCells holds the free cells densely and freeSlot maps a cell to its position
+    // there (-1 when taken), so adding or taking a cell and picking a random free cell are all O(1).
+    int *freeCells;
+    int *freeSlot;
+    int freeCount;
+    uint8_t *food; // Food on each grid cell
+    int foodCells[FOOD_COUNT];
+    int foodCount;
+    int foodChanged; // Food was eaten or spawned by the last step
+    int *growth; // Segments each snake has eaten and not grown yet
+    int *ate; // Snake ate during the last step
+    uint64_t randomState;
+
+    // Scratch space for one step, one entry per snake
+    Snake *next;
+    int *moveKind;
+    int *outOfBounds;
+    int *collided;
+} World;
+
+int initWorld(World *world, int snakeCount, uint64_t seed);
+void freeWorld(World *world);
+
+// One tick, in four phases:
+//   1. parallel: take each snake's proposed state and classify how it moved
+//   2. serial:   apply the moves to the occupancy grid in snake order
+//   3. parallel: collision queries against the now read-only grid
+//   4. serial:   resolve deaths in snake order (head-on collisions kill both snakes), then let
+//                every surviving head eat the food under it and refill the board from free cells
+// Parallel phases only write their own snake's entry, so the result does not depend on the
+// number of threads. A dead snake ignores further updates until it leaves the match, and a snake
+// only grows as far as the food it ate allows.
+// killed[i] is set to 1 for every snake the step killed.
+void stepWorld(World *world, const Snake *updates, const int *hasUpdate, const int *present, int *killed, WorkPool *pool);
+
+// Pending Inputs
+// Snake updates a player sent ahead of the tick they are stamped for, sorted by target tick and
+// in arrival order among equal ticks. A tick takes at most one input per player, so every position
+// a snake moves through goes through a collision step, and an early input waiting for its tick
+// never holds back a later-sent one that is already due.
+#define INPUT_BUFFER_SIZE 8
+
+typedef struct {
+    Snake snake;
+    uint32_t targetTick;
+    uint64_t sendTime; // Client's send time on the server clock, 0 if the client is not synchronized
+    uint64_t receiveTime;
+} PendingInput;
+
+typedef struct {
+    PendingInput inputs[INPUT_BUFFER_SIZE];
+    int count;
+} InputBuffer;
+
+// Each input is a whole snake, so when the buffer is full the one due first is superseded.
+// An input equal to the one queued ahead of it is dropped, it would not move the snake.
+void insertInput(InputBuffer *buffer, const PendingInput *input);
+// Returns 1 and removes the first input due on or before tick, or returns 0
+int takeDueInput(InputBuffer *buffer, uint32_t tick, PendingInput *input);
+
+#endif
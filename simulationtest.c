@@ -0,0 +1,259 @@
+// Checks for the server's simulation step, run without a server or clients.
+//
+// Usage: ./simulation-test
+//   Prints every failed check and exits non-zero if there was one
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulation.h"
+#include "workpool.h"
+
+#define TEST_SNAKES 2
+#define TEST_LENGTH 6 // Head included
+#define CROWD_SNAKES 64 // Enough for stepWorld to split every parallel phase into chunks
+#define CROWD_TICKS 400
+
+int failures = 0;
+
+void check(int condition, const char *name) {
+    if (condition) return;
+    printf("FAILED: %s\n", name);
+    failures++;
+}
+
+// Horizontal snake with its head at (column, row), facing right
+Snake straightSnake(int column, int row) {
+    Snake snake;
+    memset(&snake, 0, sizeof(Snake));
+    snake.isAlive = 1;
+    snake.body_length = TEST_LENGTH - 1;
+    snake.head.x = column * SNAKE_SEGMENT_DIMENSION;
+    snake.head.y = row * SNAKE_SEGMENT_DIMENSION;
+    for (int i = 0; i < snake.body_length; ++i) {
+        snake.body[i].x = snake.head.x - (i + 1) * SNAKE_SEGMENT_DIMENSION;
+        snake.body[i].y = snake.head.y;
+    }
+    return snake;
+}
+
+// Vertical wall of a snake through (column, row), used as an obstacle
+Snake wallSnake(int column, int row) {
+    Snake snake;
+    memset(&snake, 0, sizeof(Snake));
+    snake.isAlive = 1;
+    snake.body_length = TEST_LENGTH - 1;
+    snake.head.x = column * SNAKE_SEGMENT_DIMENSION;
+    snake.head.y = (row - 2) * SNAKE_SEGMENT_DIMENSION;
+    for (int i = 0; i < snake.body_length; ++i) {
+        snake.body[i].x = snake.head.x;
+        snake.body[i].y = snake.head.y + (i + 1) * SNAKE_SEGMENT_DIMENSION;
+    }
+    return snake;
+}
+
+Snake movedRight(const Snake *snake) {
+    Snake moved = *snake;
+    for (int i = moved.body_length - 1; i > 0; --i) moved.body[i] = moved.body[i - 1];
+    moved.body[0] = moved.head;
+    moved.head.x += SNAKE_SEGMENT_DIMENSION;
+    return moved;
+}
+
+// One server tick: each player's next due input, or its starting snake when it joins
+void runTick(World *world, InputBuffer *buffers, const Snake *starting, uint32_t tick, int *killed) {
+    Snake updates[TEST_SNAKES];
+    int hasUpdate[TEST_SNAKES] = {0};
+    int present[TEST_SNAKES];
+
+    for (int p = 0; p < TEST_SNAKES; ++p) {
+        PendingInput input;
+        present[p] = 1;
+        if (takeDueInput(&buffers[p], tick, &input)) {
+            updates[p] = input.snake;
+            hasUpdate[p] = 1;
+        } else if (!world->present[p]) {
+            updates[p] = starting[p];
+            hasUpdate[p] = 1;
+        }
+    }
+    stepWorld(world, updates, hasUpdate, present, killed, NULL);
+}
+
+// Two moves that arrive due on the same tick: the obstacle sits under the first or the second one
+void testTwoDueMoves(int blockedMove) {
+    World world;
+    InputBuffer buffers[TEST_SNAKES] = {0};
+    Snake starting[TEST_SNAKES];
+    int killed[TEST_SNAKES];
+
+    starting[0] = straightSnake(10, 10);
+    starting[1] = wallSnake(10 + blockedMove, 10);
+    if (initWorld(&world, TEST_SNAKES, 1) == -1) {
+        perror("Error creating the world");
+        exit(EXIT_FAILURE);
+    }
+    runTick(&world, buffers, starting, 1, killed);
+
+    Snake first = movedRight(&starting[0]);
+    Snake second = movedRight(&first);
+    PendingInput input = { first, 2, 0, 0 };
+    insertInput(&buffers[0], &input);
+    input.snake = second;
+    insertInput(&buffers[0], &input);
+
+    runTick(&world, buffers, starting, 2, killed);
+    if (blockedMove == 1) {
+        check(killed[0], "first of two due moves is collision-checked");
+    } else {
+        check(!killed[0] && world.snakes[0].head.x == first.head.x, "only one due move is applied per tick");
+        runTick(&world, buffers, starting, 3, killed);
+        check(killed[0], "second of two due moves is collision-checked on the next tick");
+    }
+    freeWorld(&world);
+}
+
+void testInputOrder() {
+    InputBuffer buffer = {0};
+    PendingInput input;
+    memset(&input, 0, sizeof(PendingInput));
+
+    // Every input moves the snake, so none of them is dropped as a copy
+    input.targetTick = 12;
+    input.sendTime = input.snake.head.x = 1;
+    insertInput(&buffer, &input);
+    input.targetTick = 11;
+    input.sendTime = input.snake.head.x = 2;
+    insertInput(&buffer, &input);
+    input.targetTick = 11;
+    input.sendTime = input.snake.head.x = 3;
+    insertInput(&buffer, &input);
+
+    PendingInput taken;
+    check(!takeDueInput(&buffer, 10, &taken), "nothing is taken before its tick");
+    check(takeDueInput(&buffer, 11, &taken) && taken.sendTime == 2, "a later-sent input due earlier is not held back");
+    check(takeDueInput(&buffer, 11, &taken) && taken.sendTime == 3, "inputs for the same tick keep their arrival order");
+    check(!takeDueInput(&buffer, 11, &taken), "an input for a later tick waits");
+    check(takeDueInput(&buffer, 12, &taken) && taken.sendTime == 1, "the input for the later tick is taken on it");
+
+    input.targetTick = 13;
+    insertInput(&buffer, &input);
+    input.targetTick = 14;
+    insertInput(&buffer, &input);
+    check(buffer.count == 1, "an unchanged snake sent again does not take another tick");
+    takeDueInput(&buffer, 13, &taken);
+
+    for (int i = 0; i < INPUT_BUFFER_SIZE + 2; ++i) {
+        input.targetTick = 20 + i;
+        input.snake.head.x = i;
+        insertInput(&buffer, &input);
+    }
+    check(buffer.count == INPUT_BUFFER_SIZE && buffer.inputs[0].targetTick == 22, "a full buffer supersedes the input due first");
+}
+
+// Fixed sequence for the crowd's moves, separate from the world's own food generator
+uint32_t crowdRandom(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 16;
+}
+
+// One step of a snake in its current direction or a turn off it, sometimes a segment longer
+Snake randomMove(const Snake *snake, uint32_t *state) {
+    Snake moved = *snake;
+    int deltaX = snake->head.x - snake->body[0].x;
+    int deltaY = snake->head.y - snake->body[0].y;
+    uint32_t roll = crowdRandom(state);
+
+    if (roll % 4 == 0) {
+        int turned = deltaX;
+        deltaX = roll & 4 ? deltaY : -deltaY;
+        deltaY = roll & 4 ? -turned : turned;
+    }
+    if (roll % 8 == 1 && moved.body_length < MAX_SNAKE_LENGTH - 1) moved.body_length++;
+    for (int i = moved.body_length - 1; i > 0; --i) moved.body[i] = moved.body[i - 1];
+    moved.body[0] = moved.head;
+    moved.head.x += deltaX;
+    moved.head.y += deltaY;
+    return moved;
+}
+
+// The same crowd stepped inline, on 4 and on 7 workers must end every tick in the same world
+void testThreadCounts() {
+    int threadCounts[] = { 0, 4, 7 };
+    int runs = sizeof(threadCounts) / sizeof(threadCounts[0]);
+    World worlds[3];
+    WorkPool *pools[3];
+    int killed[3][CROWD_SNAKES];
+    Snake *updates = malloc(CROWD_SNAKES * sizeof(Snake));
+    int hasUpdate[CROWD_SNAKES];
+    int present[CROWD_SNAKES];
+    int gone[CROWD_SNAKES] = {0}; // Ticks a dead snake has been out of the match
+    uint32_t moves = 1;
+    int deaths = 0;
+
+    for (int r = 0; r < runs; ++r) {
+        pools[r] = createWorkPool(threadCounts[r]);
+        if (updates == NULL || pools[r] == NULL || initWorld(&worlds[r], CROWD_SNAKES, 7) == -1) {
+            perror("Error creating the crowd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    int diverged = 0;
+    for (int tick = 0; tick < CROWD_TICKS && !diverged; ++tick) {
+        // Inputs come from the first world, every run is fed the same ones
+        World *world = &worlds[0];
+        for (int i = 0; i < CROWD_SNAKES; ++i) {
+            Snake start = straightSnake(8 + (i % 8) * 9, 3 + (i / 8) * 5);
+            present[i] = 1;
+            hasUpdate[i] = 1;
+            if (!world->present[i]) {
+                updates[i] = start;
+            } else if (world->snakes[i].isAlive) {
+                updates[i] = randomMove(&world->snakes[i], &moves);
+            } else if (++gone[i] < 3) {
+                // Leaves the match for a tick, then comes back at its starting place
+                present[i] = gone[i] == 1;
+                hasUpdate[i] = 0;
+            } else {
+                gone[i] = 0;
+                updates[i] = start;
+            }
+        }
+
+        for (int r = 0; r < runs; ++r) stepWorld(&worlds[r], updates, hasUpdate, present, killed[r], pools[r]);
+        for (int i = 0; i < CROWD_SNAKES; ++i) deaths += killed[0][i];
+
+        for (int r = 1; r < runs; ++r) {
+            World *other = &worlds[r];
+            diverged |= other->hash != world->hash || other->freeCount != world->freeCount ||
+                other->foodCount != world->foodCount ||
+                memcmp(other->foodCells, world->foodCells, sizeof(world->foodCells)) != 0 ||
+                memcmp(killed[r], killed[0], sizeof(killed[0])) != 0 ||
+                memcmp(other->growth, world->growth, CROWD_SNAKES * sizeof(int)) != 0 ||
+                memcmp(other->snakes, world->snakes, CROWD_SNAKES * sizeof(Snake)) != 0;
+        }
+    }
+    check(!diverged, "stepping on 0, 4 and 7 worker threads gives the same world every tick");
+    check(deaths > CROWD_SNAKES, "the crowd collides often enough to exercise the collision phase");
+
+    for (int r = 0; r < runs; ++r) {
+        freeWorld(&worlds[r]);
+        destroyWorkPool(pools[r]);
+    }
+    free(updates);
+}
+
+int main() {
+    testTwoDueMoves(1);
+    testTwoDueMoves(2);
+    testInputOrder();
+    testThreadCounts();
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("All simulation checks passed\n");
+    return EXIT_SUCCESS;
+}
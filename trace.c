@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "protocol.h"
+#include "trace.h"
+
+#define TRACE_COMPLETE 'X'
+#define TRACE_INSTANT 'i'
+#define TRACE_COUNTER 'C'
+
+typedef struct {
+    const char *name;
+    uint64_t start; // monotonicMicros()
+    uint32_t duration;
+    char phase;
+    int64_t argument;
+} TraceEvent;
+
+// Written only by its owner thread, head is published after each event for the exporter
+typedef struct {
+    const char *threadName;
+    _Atomic uint64_t head;
+    TraceEvent events[TRACE_RING_EVENTS];
+} TraceRing;
+
+int traceEnabled = 0;
+static TraceRing *rings[TRACE_MAX_THREADS];
+static int ringCount = 0;
+static pthread_mutex_t ringMutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread TraceRing *threadRing = NULL;
+static __thread int threadRingFailed = 0;
+
+void traceInit() {
+    const char *setting = getenv("SNAKE_TRACE");
+    traceEnabled = setting != NULL && setting[0] != '\0' && setting[0] != '0';
+}
+
+// The first event on a thread registers its ring, later events only touch thread-local memory
+static TraceRing *currentRing() {
+    if (threadRing != NULL || threadRingFailed) return threadRing;
+
+    TraceRing *ring = calloc(1, sizeof(TraceRing));
+    pthread_mutex_lock(&ringMutex);
+    if (ring != NULL && ringCount < TRACE_MAX_THREADS) {
+        rings[ringCount++] = ring;
+        threadRing = ring;
+    } else {
+        free(ring);
+        threadRingFailed = 1;
+    }
+    pthread_mutex_unlock(&ringMutex);
+    return threadRing;
+}
+
+static void record(const char *name, char phase, uint64_t start, uint32_t duration, int64_t argument) {
+    TraceRing *ring = currentRing();
+    if (ring == NULL) return;
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    TraceEvent *event = &ring->events[head & (TRACE_RING_EVENTS - 1)];
+    event->name = name;
+    event->phase = phase;
+    event->start = start;
+    event->duration = duration;
+    event->argument = argument;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void traceThreadName(const char *name) {
+    if (!traceEnabled) return;
+    TraceRing *ring = currentRing();
+    if (ring != NULL) ring->threadName = name;
+}
+
+uint64_t traceBegin() {
+    return traceEnabled ? monotonicMicros() : 0;
+}
+
+void traceEnd(const char *name, uint64_t start, int64_t argument) {
+    if (!traceEnabled || start == 0) return;
+    record(name, TRACE_COMPLETE, start, monotonicMicros() - start, argument);
+}
+
+void traceInstant(const char *name, int64_t argument) {
+    if (!traceEnabled) return;
+    record(name, TRACE_INSTANT, monotonicMicros(), 0, argument);
+}
+
+void traceCounter(const char *name, int64_t value) {
+    if (!traceEnabled) return;
+    record(name, TRACE_COUNTER, monotonicMicros(), 0, value);
+}
+
+static void writeEvent(FILE *file, const TraceEvent *event, int pid, int tid, int *first) {
+    fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,\"pid\":%d,\"tid\":%d",
+        *first ? "" : ",", event->name, event->phase, (unsigned long long)event->start, pid, tid);
+    if (event->phase == TRACE_COMPLETE) fprintf(file, ",\"dur\":%u", event->duration);
+    if (event->phase == TRACE_INSTANT) fprintf(file, ",\"s\":\"t\"");
+    fprintf(file, ",\"args\":{\"value\":%lld}}", (long long)event->argument);
+    *first = 0;
+}
+
+// Safe to call while other threads keep recording: events overwritten during the copy are left out
+int traceExport(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) return -1;
+
+    TraceEvent *copy = malloc(TRACE_RING_EVENTS * sizeof(TraceEvent));
+    if (copy == NULL) {
+        fclose(file);
+        return -1;
+    }
+
+    int pid = getpid();
+    int first = 1;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+    pthread_mutex_lock(&ringMutex);
+    for (int r = 0; r < ringCount; ++r) {
+        TraceRing *ring = rings[r];
+        int tid = r + 1;
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",", pid, tid, ring->threadName != NULL ? ring->threadName : "thread");
+        first = 0;
+
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t oldest = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = oldest; i < head; ++i) copy[i - oldest] = ring->events[i & (TRACE_RING_EVENTS - 1)];
+
+        // The owner may be writing event newHead, which reuses the slot of newHead - TRACE_RING_EVENTS
+        uint64_t newHead = atomic_load_explicit(&ring->head, memory_order_acquire);
+        uint64_t valid = newHead + 1 > TRACE_RING_EVENTS ? newHead + 1 - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = oldest > valid ? oldest : valid; i < head; ++i) {
+            writeEvent(file, &copy[i - oldest], pid, tid, &first);
+        }
+    }
+    pthread_mutex_unlock(&ringMutex);
+
+    fprintf(file, "\n]}\n");
+    free(copy);
+    return fclose(file) == 0 ? 0 : -1;
+}
@@ -0,0 +1,28 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+// Frame tracing for the client, off unless SNAKE_TRACE is set in the environment.
+// Every thread records into its own ring buffer, so recording never takes a lock; once the ring
+// is full the oldest events are overwritten. traceExport() writes what the rings hold as
+// Chrome trace-event JSON, which chrome://tracing and ui.perfetto.dev can open.
+// Event names must be string literals, only the pointer is stored.
+
+#define TRACE_RING_EVENTS 65536 // Per thread, a power of two
+#define TRACE_MAX_THREADS 8
+
+extern int traceEnabled;
+
+void traceInit();
+void traceThreadName(const char *name);
+
+// Timed section: start = traceBegin(); ...; traceEnd("name", start, argument)
+uint64_t traceBegin();
+void traceEnd(const char *name, uint64_t start, int64_t argument);
+void traceInstant(const char *name, int64_t argument);
+void traceCounter(const char *name, int64_t value);
+
+int traceExport(const char *path);
+
+#endif
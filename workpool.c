@@ -0,0 +1,157 @@
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "workpool.h"
+
+typedef struct {
+    atomic_int next; // Next chunk to claim, by the owner or by a thief
+    int end;
+    char padding[56]; // Keep each slice on its own cache line
+} WorkSlice;
+
+struct WorkPool {
+    int threadCount;
+    pthread_t *threads;
+    WorkSlice *slices; // threadCount + 1, the last one belongs to the calling thread
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    int generation;
+    int busyWorkers;
+    int shutdown;
+
+    // Current job
+    WorkFunction function;
+    void *context;
+    int count;
+    int grain;
+};
+
+typedef struct {
+    WorkPool *pool;
+    int index;
+} WorkerInfo;
+
+static void drainSlice(WorkPool *pool, WorkSlice *slice) {
+    int chunk;
+    while ((chunk = atomic_fetch_add(&slice->next, 1)) < slice->end) {
+        int begin = chunk * pool->grain;
+        int end = begin + pool->grain;
+        if (end > pool->count) end = pool->count;
+        pool->function(pool->context, begin, end);
+    }
+}
+
+// Own slice first, then steal from every other participant in turn
+static void participate(WorkPool *pool, int index) {
+    int participants = pool->threadCount + 1;
+    for (int i = 0; i < participants; ++i) {
+        drainSlice(pool, &pool->slices[(index + i) % participants]);
+    }
+}
+
+static void *workerHandler(void *arg) {
+    WorkerInfo *info = (WorkerInfo *)arg;
+    WorkPool *pool = info->pool;
+    int index = info->index;
+    int seenGeneration = 0;
+    free(info);
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seenGeneration && !pool->shutdown) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seenGeneration = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        participate(pool, index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->busyWorkers == 0) pthread_cond_signal(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return NULL;
+}
+
+WorkPool *createWorkPool(int threadCount) {
+    WorkPool *pool = calloc(1, sizeof(WorkPool));
+    if (pool == NULL) return NULL;
+
+    pool->threads = calloc(threadCount > 0 ? threadCount : 1, sizeof(pthread_t));
+    pool->slices = calloc(threadCount + 1, sizeof(WorkSlice));
+    if (pool->threads == NULL || pool->slices == NULL) {
+        free(pool->threads);
+        free(pool->slices);
+        free(pool);
+        return NULL;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (int i = 0; i < threadCount; ++i) {
+        WorkerInfo *info = malloc(sizeof(WorkerInfo));
+        info->pool = pool;
+        info->index = i;
+        if (pthread_create(&pool->threads[i], NULL, workerHandler, info) != 0) {
+            free(info);
+            break;
+        }
+        pool->threadCount++;
+    }
+    return pool;
+}
+
+void destroyWorkPool(WorkPool *pool) {
+    if (pool == NULL) return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threadCount; ++i) pthread_join(pool->threads[i], NULL);
+    free(pool->threads);
+    free(pool->slices);
+    free(pool);
+}
+
+void runParallel(WorkPool *pool, int count, int grain, WorkFunction function, void *context) {
+    if (grain < 1) grain = 1;
+    if (pool == NULL || pool->threadCount == 0 || count <= grain) {
+        if (count > 0) function(context, 0, count);
+        return;
+    }
+
+    int participants = pool->threadCount + 1;
+    int chunks = (count + grain - 1) / grain;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->function = function;
+    pool->context = context;
+    pool->count = count;
+    pool->grain = grain;
+    for (int i = 0; i < participants; ++i) {
+        atomic_store(&pool->slices[i].next, (int)((long long)chunks * i / participants));
+        pool->slices[i].end = (int)((long long)chunks * (i + 1) / participants);
+    }
+    pool->busyWorkers = pool->threadCount;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    participate(pool, pool->threadCount);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->busyWorkers > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
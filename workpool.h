@@ -0,0 +1,19 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+// Fixed pool of worker threads for parallel loops over [0, count).
+// The range is cut into chunks of `grain` items and dealt out as one contiguous slice per
+// participant (the workers plus the calling thread). A participant that finishes its own slice
+// steals the remaining chunks of the others, so uneven work still balances out.
+typedef void (*WorkFunction)(void *context, int begin, int end);
+
+typedef struct WorkPool WorkPool;
+
+WorkPool *createWorkPool(int threadCount);
+void destroyWorkPool(WorkPool *pool);
+
+// Runs function over every chunk and returns once all of them are done.
+// Small ranges (count <= grain) or a NULL pool run inline on the caller.
+void runParallel(WorkPool *pool, int count, int grain, WorkFunction function, void *context);
+
+#endif